@@ -0,0 +1,237 @@
+/* buffer_cache.c: Sector cache in front of the file system disk.
+ *
+ * Every read and write of filesys_disk goes through BUFFER_CACHE_SIZE
+ * sector buffers.  A write only marks its buffer dirty; the sector goes
+ * to disk when the buffer is evicted or at buffer_cache_flush().  Buffers
+ * are replaced in clock order.
+ *
+ * One lock protects every buffer.  It is dropped during disk I/O, with
+ * the buffer marked busy so that nobody else uses or evicts it until the
+ * transfer is done.
+ *
+ * buffer_cache_readahead() queues sectors that a reader is expected to
+ * need soon.  The readahead thread reads them in while the reader goes
+ * on with what it already has. */
+
+#include "filesys/buffer_cache.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* One cached sector. */
+struct buffer {
+	disk_sector_t sector;       /* Sector held, if VALID. */
+	bool valid;                 /* Holds SECTOR. */
+	bool dirty;                 /* Differs from the disk. */
+	bool accessed;              /* Used since the clock hand passed. */
+	bool busy;                  /* Disk I/O in progress. */
+	uint8_t data[DISK_SECTOR_SIZE];
+};
+
+static struct buffer buffers[BUFFER_CACHE_SIZE];
+static struct lock cache_lock;
+static struct condition io_done;    /* A buffer stopped being busy. */
+static size_t clock_hand;
+
+/* Sectors waiting for the readahead thread, a ring buffer protected by
+ * cache_lock.  Requests that do not fit are dropped. */
+#define RA_QUEUE_SIZE 32
+static disk_sector_t ra_queue[RA_QUEUE_SIZE];
+static size_t ra_head, ra_tail;     /* Next slot to fill, to take. */
+static struct condition ra_ready;   /* The queue is not empty. */
+
+/* Statistics. */
+static unsigned long long cache_hits;
+static unsigned long long cache_misses;
+static unsigned long long write_behinds;    /* Dirty buffers written. */
+static unsigned long long readaheads;       /* Sectors read ahead. */
+
+static void readahead_daemon (void *aux);
+
+/* Initializes the buffer cache. */
+void
+buffer_cache_init (void) {
+	lock_init (&cache_lock);
+	cond_init (&io_done);
+	cond_init (&ra_ready);
+	thread_create ("readahead", PRI_DEFAULT, readahead_daemon, NULL);
+}
+
+/* Returns the buffer holding SECTOR, or a null pointer.  Needs
+ * cache_lock. */
+static struct buffer *
+lookup (disk_sector_t sector) {
+	for (size_t i = 0; i < BUFFER_CACHE_SIZE; i++)
+		if (buffers[i].valid && buffers[i].sector == sector)
+			return &buffers[i];
+	return NULL;
+}
+
+/* Writes B back to the disk.  Needs cache_lock, which is released
+ * during the write. */
+static void
+write_back (struct buffer *b) {
+	ASSERT (b->valid && b->dirty && !b->busy);
+
+	b->busy = true;
+	b->dirty = false;
+	lock_release (&cache_lock);
+	disk_write (filesys_disk, b->sector, b->data);
+	lock_acquire (&cache_lock);
+	b->busy = false;
+	write_behinds++;
+	cond_broadcast (&io_done, &cache_lock);
+}
+
+/* Picks a buffer to reuse in clock order, or returns a null pointer if
+ * all of them are busy.  Needs cache_lock. */
+static struct buffer *
+pick_victim (void) {
+	for (size_t n = 0; n < 2 * BUFFER_CACHE_SIZE; n++) {
+		struct buffer *b = &buffers[clock_hand];
+		clock_hand = (clock_hand + 1) % BUFFER_CACHE_SIZE;
+
+		if (b->busy)
+			continue;
+		if (!b->valid)
+			return b;
+		if (b->accessed)
+			b->accessed = false;
+		else
+			return b;
+	}
+	return NULL;
+}
+
+/* Returns the buffer for SECTOR, not busy.  Unless FILL is false, which
+ * means that the caller overwrites the whole sector, it holds the
+ * contents of SECTOR.  Needs cache_lock, which may be released and
+ * reacquired meanwhile. */
+static struct buffer *
+get_buffer_locked (disk_sector_t sector, bool fill) {
+	struct buffer *b;
+
+	for (;;) {
+		b = lookup (sector);
+		if (b != NULL) {
+			if (!b->busy) {
+				cache_hits++;
+				break;
+			}
+			cond_wait (&io_done, &cache_lock);
+			continue;
+		}
+
+		b = pick_victim ();
+		if (b == NULL) {
+			cond_wait (&io_done, &cache_lock);
+			continue;
+		}
+		/* The lock is dropped during the write, so look again. */
+		if (b->valid && b->dirty) {
+			write_back (b);
+			continue;
+		}
+
+		cache_misses++;
+		b->sector = sector;
+		b->valid = true;
+		b->dirty = false;
+		if (fill) {
+			b->busy = true;
+			lock_release (&cache_lock);
+			disk_read (filesys_disk, sector, b->data);
+			lock_acquire (&cache_lock);
+			b->busy = false;
+			cond_broadcast (&io_done, &cache_lock);
+		}
+		break;
+	}
+	b->accessed = true;
+	return b;
+}
+
+/* get_buffer_locked() that acquires cache_lock first.  Returns with it
+ * held. */
+static struct buffer *
+get_buffer (disk_sector_t sector, bool fill) {
+	lock_acquire (&cache_lock);
+	return get_buffer_locked (sector, fill);
+}
+
+/* Reads SIZE bytes at offset OFS of SECTOR into BUFFER. */
+void
+buffer_cache_read (disk_sector_t sector, void *buffer, size_t ofs,
+		size_t size) {
+	ASSERT (ofs + size <= DISK_SECTOR_SIZE);
+
+	struct buffer *b = get_buffer (sector, true);
+	memcpy (buffer, b->data + ofs, size);
+	lock_release (&cache_lock);
+}
+
+/* Writes SIZE bytes from BUFFER at offset OFS of SECTOR.  A write of a
+ * whole sector does not read it first. */
+void
+buffer_cache_write (disk_sector_t sector, const void *buffer, size_t ofs,
+		size_t size) {
+	ASSERT (ofs + size <= DISK_SECTOR_SIZE);
+
+	struct buffer *b = get_buffer (sector, size < DISK_SECTOR_SIZE);
+	memcpy (b->data + ofs, buffer, size);
+	b->dirty = true;
+	lock_release (&cache_lock);
+}
+
+/* Asks the readahead thread to bring SECTOR into the cache. */
+void
+buffer_cache_readahead (disk_sector_t sector) {
+	lock_acquire (&cache_lock);
+	if (lookup (sector) == NULL && ra_head - ra_tail < RA_QUEUE_SIZE) {
+		ra_queue[ra_head++ % RA_QUEUE_SIZE] = sector;
+		cond_signal (&ra_ready, &cache_lock);
+	}
+	lock_release (&cache_lock);
+}
+
+/* Reads queued sectors into the cache.  They are left as not accessed,
+ * so a sector that nobody reads after all is the first to go. */
+static void
+readahead_daemon (void *aux UNUSED) {
+	lock_acquire (&cache_lock);
+	for (;;) {
+		while (ra_head == ra_tail)
+			cond_wait (&ra_ready, &cache_lock);
+
+		disk_sector_t sector = ra_queue[ra_tail++ % RA_QUEUE_SIZE];
+		if (lookup (sector) == NULL) {
+			get_buffer_locked (sector, true)->accessed = false;
+			readaheads++;
+		}
+	}
+}
+
+/* Writes every dirty buffer back to the disk. */
+void
+buffer_cache_flush (void) {
+	lock_acquire (&cache_lock);
+	for (size_t i = 0; i < BUFFER_CACHE_SIZE; i++) {
+		struct buffer *b = &buffers[i];
+		while (b->busy)
+			cond_wait (&io_done, &cache_lock);
+		if (b->valid && b->dirty)
+			write_back (b);
+	}
+	lock_release (&cache_lock);
+}
+
+/* Prints buffer cache statistics. */
+void
+buffer_cache_print_stats (void) {
+	printf ("Buffer cache: %llu hits, %llu misses (%llu read ahead), "
+			"%llu write-behinds\n",
+			cache_hits, cache_misses, readaheads, write_behinds);
+}
@@ -0,0 +1,179 @@
+/* dcache.c: Cache of directory lookups.
+ *
+ * Maps a name in a directory, identified by the sector of its inode, to
+ * the inode sector of the file by that name, or to 0 if the directory has
+ * no such file.  Sector 0 never holds a file's inode, so it cannot be
+ * mistaken for one.  A hit spares dir_lookup() reading the directory.
+ *
+ * directory.c keeps the cache in step: dir_add() and dir_remove() put the
+ * new answer for the name.  An answer that dir_lookup() read from the
+ * directory itself is only filled in if no put came in since the read
+ * began, so a lookup that lost a race with a create or a remove cannot
+ * bring back the old answer.  At most DCACHE_SIZE names are kept, and the
+ * least recently used one makes room for a new one. */
+
+#include "filesys/dcache.h"
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/synch.h"
+
+/* A cached name. */
+struct dentry {
+	struct hash_elem elem;      /* In DENTRIES. */
+	struct list_elem lru_elem;  /* In LRU. */
+	disk_sector_t dir;          /* Inode sector of the directory. */
+	char name[NAME_MAX + 1];    /* Name in DIR. */
+	disk_sector_t sector;       /* Inode sector of NAME, 0 if none. */
+};
+
+static struct dentry pool[DCACHE_SIZE];
+static size_t pool_used;            /* Entries of POOL handed out. */
+static struct hash dentries;
+static struct list lru;             /* Most recently used first. */
+static struct lock dcache_lock;
+static unsigned dcache_generation;  /* Puts so far. */
+
+/* Statistics. */
+static unsigned long long dcache_hits;
+static unsigned long long negative_hits;
+static unsigned long long dcache_misses;
+
+static uint64_t
+dentry_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct dentry *d = hash_entry (e, struct dentry, elem);
+
+	return hash_string (d->name) ^ hash_int (d->dir);
+}
+
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct dentry *a = hash_entry (a_, struct dentry, elem);
+	const struct dentry *b = hash_entry (b_, struct dentry, elem);
+
+	if (a->dir != b->dir)
+		return a->dir < b->dir;
+	return strcmp (a->name, b->name) < 0;
+}
+
+/* Initializes the dentry cache. */
+void
+dcache_init (void) {
+	hash_init (&dentries, dentry_hash, dentry_less, NULL);
+	list_init (&lru);
+	lock_init (&dcache_lock);
+}
+
+/* Returns the entry for NAME in DIR, or a null pointer.  Needs
+ * dcache_lock. */
+static struct dentry *
+dentry_find (disk_sector_t dir, const char *name) {
+	struct dentry key;
+	struct hash_elem *e;
+
+	key.dir = dir;
+	strlcpy (key.name, name, sizeof key.name);
+	e = hash_find (&dentries, &key.elem);
+	return e != NULL ? hash_entry (e, struct dentry, elem) : NULL;
+}
+
+/* Looks NAME up in the directory whose inode is in sector DIR.  Returns
+ * false if the cache does not know.  Otherwise sets *SECTORP to the
+ * inode sector of NAME, or to 0 if DIR has no file by that name, and
+ * returns true. */
+bool
+dcache_get (disk_sector_t dir, const char *name, disk_sector_t *sectorp) {
+	struct dentry *d;
+
+	if (strlen (name) > NAME_MAX)
+		return false;
+
+	lock_acquire (&dcache_lock);
+	d = dentry_find (dir, name);
+	if (d != NULL) {
+		list_remove (&d->lru_elem);
+		list_push_front (&lru, &d->lru_elem);
+		*sectorp = d->sector;
+		dcache_hits++;
+		if (d->sector == 0)
+			negative_hits++;
+	} else
+		dcache_misses++;
+	lock_release (&dcache_lock);
+	return d != NULL;
+}
+
+/* Sets the entry for NAME in DIR to SECTOR, making one if needed.
+ * Needs dcache_lock. */
+static void
+dentry_set (disk_sector_t dir, const char *name, disk_sector_t sector) {
+	struct dentry *d;
+
+	d = dentry_find (dir, name);
+	if (d != NULL)
+		list_remove (&d->lru_elem);
+	else {
+		if (pool_used < DCACHE_SIZE)
+			d = &pool[pool_used++];
+		else {
+			d = list_entry (list_pop_back (&lru), struct dentry, lru_elem);
+			hash_delete (&dentries, &d->elem);
+		}
+		d->dir = dir;
+		strlcpy (d->name, name, sizeof d->name);
+		hash_insert (&dentries, &d->elem);
+	}
+	d->sector = sector;
+	list_push_front (&lru, &d->lru_elem);
+}
+
+/* Records that NAME in the directory whose inode is in sector DIR is the
+ * file whose inode is in SECTOR, or that there is no such file if SECTOR
+ * is 0.  For callers that have just changed the directory. */
+void
+dcache_put (disk_sector_t dir, const char *name, disk_sector_t sector) {
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dcache_lock);
+	dcache_generation++;
+	dentry_set (dir, name, sector);
+	lock_release (&dcache_lock);
+}
+
+/* Returns the generation to pass to dcache_fill(), taken before reading
+ * the directory. */
+unsigned
+dcache_gen (void) {
+	unsigned gen;
+
+	lock_acquire (&dcache_lock);
+	gen = dcache_generation;
+	lock_release (&dcache_lock);
+	return gen;
+}
+
+/* Like dcache_put(), for an answer read from the directory by a lookup
+ * that started at generation GEN.  Does nothing if any put came in since,
+ * as the answer may predate it. */
+void
+dcache_fill (disk_sector_t dir, const char *name, disk_sector_t sector,
+		unsigned gen) {
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dcache_lock);
+	if (gen == dcache_generation)
+		dentry_set (dir, name, sector);
+	lock_release (&dcache_lock);
+}
+
+/* Prints dentry cache statistics. */
+void
+dcache_print_stats (void) {
+	printf ("Dentry cache: %llu hits (%llu negative), %llu misses\n",
+			dcache_hits, negative_hits, dcache_misses);
+}
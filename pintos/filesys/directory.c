@@ -2,9 +2,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include <round.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#ifdef EFILESYS
+#include "filesys/fat.h"
+#endif
 
 /* A directory. */
 struct dir {
@@ -19,11 +24,67 @@ struct dir_entry {
 	bool in_use;                        /* In use or free? */
 };
 
-/* Creates a directory with space for ENTRY_CNT entries in the
- * given SECTOR.  Returns true if successful, false on failure. */
+/* A directory is a hash table of entries.  An entry whose name hashes
+ * to bucket B sits in one of the DIR_PROBE slots starting at slot B, so
+ * a table of N buckets has N + DIR_PROBE - 1 slots and finding a name
+ * takes one read of DIR_PROBE entries.  When a new name finds no free
+ * slot there, the table is rebuilt with twice the buckets.  Free slots
+ * are unused entries, so dir_readdir() reads the table in order like any
+ * other directory. */
+#define DIR_PROBE 8
+#define DIR_MIN_BUCKETS 16
+
+/* The first slot of a directory holds a header that tells where the
+ * table is.  A rebuilt table is written past the end of the file, and
+ * the header is pointed at it only once that write is complete, so a
+ * failed or short write leaves the old table in use.  Old tables are not
+ * reused; each table is twice the size of the one before, so together
+ * they never take more room than the live one. */
+struct dir_header {
+	unsigned magic;                     /* DIR_MAGIC. */
+	uint32_t buckets;                   /* Buckets in the table. */
+	off_t start;                        /* Byte offset of the table. */
+};
+#define DIR_MAGIC 0x44495248
+
+/* Reads the header of the directory INODE into H.  Returns false if it
+ * cannot be read or is not a directory header. */
+static bool
+read_header (struct inode *inode, struct dir_header *h) {
+	return inode_read_at (inode, h, sizeof *h, 0) == sizeof *h
+		&& h->magic == DIR_MAGIC;
+}
+
+/* Returns the bucket of NAME in a table of BUCKETS buckets. */
+static size_t
+dir_bucket (const char *name, size_t buckets) {
+	unsigned hash = 2166136261u;
+
+	for (; *name != '\0'; name++)
+		hash = (hash ^ (unsigned char) *name) * 16777619u;
+	return hash % buckets;
+}
+
+/* Creates a directory with ENTRY_CNT buckets in the given SECTOR.
+ * Returns true if successful, false on failure. */
 bool
 dir_create (disk_sector_t sector, size_t entry_cnt) {
-	return inode_create (sector, entry_cnt * sizeof (struct dir_entry));
+	struct dir_header h = {
+		.magic = DIR_MAGIC,
+		.buckets = entry_cnt,
+		.start = sizeof (struct dir_entry),
+	};
+	struct inode *inode;
+	bool success;
+
+	if (!inode_create (sector,
+				(1 + entry_cnt + DIR_PROBE - 1) * sizeof (struct dir_entry)))
+		return false;
+	inode = inode_open (sector);
+	success = inode != NULL
+		&& inode_write_at (inode, &h, sizeof h, 0) == sizeof h;
+	inode_close (inode);
+	return success;
 }
 
 /* Opens and returns the directory for the given INODE, of which
@@ -46,7 +107,11 @@ dir_open (struct inode *inode) {
  * Return true if successful, false on failure. */
 struct dir *
 dir_open_root (void) {
+#ifdef EFILESYS
+	return dir_open (inode_open (cluster_to_sector (ROOT_DIR_CLUSTER)));
+#else
 	return dir_open (inode_open (ROOT_DIR_SECTOR));
+#endif
 }
 
 /* Opens and returns a new directory for the same inode as DIR.
@@ -71,6 +136,24 @@ dir_get_inode (struct dir *dir) {
 	return dir->inode;
 }
 
+/* Reads the slots NAME may be in from DIR into WINDOW, which has room
+ * for DIR_PROBE entries, and returns the byte offset of the first one.
+ * Returns -1 if DIR has no buckets yet. */
+static off_t
+read_window (const struct dir *dir, const char *name,
+		struct dir_entry window[DIR_PROBE]) {
+	struct dir_header h;
+	off_t ofs;
+
+	if (!read_header (dir->inode, &h) || h.buckets == 0)
+		return -1;
+	ofs = h.start + dir_bucket (name, h.buckets) * sizeof *window;
+	if (inode_read_at (dir->inode, window, DIR_PROBE * sizeof *window, ofs)
+			!= (off_t) (DIR_PROBE * sizeof *window))
+		return -1;
+	return ofs;
+}
+
 /* Searches DIR for a file with the given NAME.
  * If successful, returns true, sets *EP to the directory entry
  * if EP is non-null, and sets *OFSP to the byte offset of the
@@ -79,24 +162,91 @@ dir_get_inode (struct dir *dir) {
 static bool
 lookup (const struct dir *dir, const char *name,
 		struct dir_entry *ep, off_t *ofsp) {
-	struct dir_entry e;
-	size_t ofs;
+	struct dir_entry window[DIR_PROBE];
+	off_t ofs;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (e.in_use && !strcmp (name, e.name)) {
+	ofs = read_window (dir, name, window);
+	if (ofs < 0)
+		return false;
+	for (size_t i = 0; i < DIR_PROBE; i++)
+		if (window[i].in_use && !strcmp (name, window[i].name)) {
 			if (ep != NULL)
-				*ep = e;
+				*ep = window[i];
 			if (ofsp != NULL)
-				*ofsp = ofs;
+				*ofsp = ofs + i * sizeof *window;
+			return true;
+		}
+	return false;
+}
+
+/* Puts E into a free slot of its window in TABLE, which has BUCKETS
+ * buckets.  Returns false if the window is full. */
+static bool
+place (struct dir_entry *table, size_t buckets, const struct dir_entry *e) {
+	struct dir_entry *window = table + dir_bucket (e->name, buckets);
+
+	for (size_t i = 0; i < DIR_PROBE; i++)
+		if (!window[i].in_use) {
+			window[i] = *e;
 			return true;
 		}
 	return false;
 }
 
+/* Rebuilds DIR with at least twice the buckets it has, and more if its
+ * entries do not all fit that way.  Returns false, with the old table
+ * still in use, if memory or the disk runs out. */
+static bool
+rehash (struct dir *dir) {
+	struct dir_header h;
+	size_t old_slots, buckets;
+	struct dir_entry *old, *table = NULL;
+	off_t size, start;
+	bool success = false;
+
+	if (!read_header (dir->inode, &h))
+		return false;
+	old_slots = h.buckets + DIR_PROBE - 1;
+	buckets = h.buckets * 2;
+	old = malloc (old_slots * sizeof *old);
+	if (old == NULL)
+		return false;
+	if (inode_read_at (dir->inode, old, old_slots * sizeof *old, h.start)
+			!= (off_t) (old_slots * sizeof *old))
+		goto done;
+
+	if (buckets < DIR_MIN_BUCKETS)
+		buckets = DIR_MIN_BUCKETS;
+	for (;; buckets *= 2) {
+		size_t i;
+
+		table = calloc (buckets + DIR_PROBE - 1, sizeof *table);
+		if (table == NULL)
+			goto done;
+		for (i = 0; i < old_slots; i++)
+			if (old[i].in_use && !place (table, buckets, &old[i]))
+				break;
+		if (i == old_slots)
+			break;
+		free (table);
+	}
+
+	size = (buckets + DIR_PROBE - 1) * sizeof *table;
+	start = ROUND_UP (inode_length (dir->inode), sizeof *table);
+	if (inode_write_at (dir->inode, table, size, start) != size)
+		goto done;
+	h.buckets = buckets;
+	h.start = start;
+	success = inode_write_at (dir->inode, &h, sizeof h, 0) == sizeof h;
+
+done:
+	free (table);
+	free (old);
+	return success;
+}
 /* Searches DIR for a file with the given NAME
  * and returns true if one exists, false otherwise.
  * On success, sets *INODE to an inode for the file, otherwise to
@@ -104,15 +254,20 @@ lookup (const struct dir *dir, const char *name,
 bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
+	disk_sector_t dir_sector = inode_get_inumber (dir->inode);
+	disk_sector_t sector;
 	struct dir_entry e;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
-		*inode = inode_open (e.inode_sector);
-	else
-		*inode = NULL;
+	if (!dcache_get (dir_sector, name, &sector)) {
+		unsigned gen = dcache_gen ();
+
+		sector = lookup (dir, name, &e, NULL) ? e.inode_sector : 0;
+		dcache_fill (dir_sector, name, sector, gen);
+	}
+	*inode = sector != 0 ? inode_open (sector) : NULL;
 
 	return *inode != NULL;
 }
@@ -136,27 +291,29 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (*name == '\0' || strlen (name) > NAME_MAX)
 		return false;
 
-	/* Check that NAME is not in use. */
-	if (lookup (dir, name, NULL, NULL))
-		goto done;
-
-	/* Set OFS to offset of free slot.
-	 * If there are no free slots, then it will be set to the
-	 * current end-of-file.
-
-	 * inode_read_at() will only return a short read at end of file.
-	 * Otherwise, we'd need to verify that we didn't get a short
-	 * read due to something intermittent such as low memory. */
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (!e.in_use)
-			break;
+	/* Check that NAME is not in use, and take the first free slot NAME
+	 * may be in.  Rehash if they are all taken. */
+	for (ofs = -1; ofs < 0; ) {
+		struct dir_entry window[DIR_PROBE];
+		off_t base = read_window (dir, name, window);
+
+		for (size_t i = 0; base >= 0 && i < DIR_PROBE; i++)
+			if (!window[i].in_use) {
+				if (ofs < 0)
+					ofs = base + i * sizeof e;
+			} else if (!strcmp (name, window[i].name))
+				goto done;
+		if (ofs < 0 && !rehash (dir))
+			goto done;
+	}
 
 	/* Write slot. */
 	e.in_use = true;
 	strlcpy (e.name, name, sizeof e.name);
 	e.inode_sector = inode_sector;
 	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+	if (success)
+		dcache_put (inode_get_inumber (dir->inode), name, inode_sector);
 
 done:
 	return success;
@@ -188,6 +345,7 @@ dir_remove (struct dir *dir, const char *name) {
 	e.in_use = false;
 	if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e)
 		goto done;
+	dcache_put (inode_get_inumber (dir->inode), name, 0);
 
 	/* Remove inode. */
 	inode_remove (inode);
@@ -203,9 +361,16 @@ done:
  * contains no more entries. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
+	struct dir_header h;
 	struct dir_entry e;
+	off_t end;
 
-	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
+	/* POS counts from the start of the table. */
+	if (!read_header (dir->inode, &h))
+		return false;
+	end = (h.buckets + DIR_PROBE - 1) * sizeof e;
+	while (dir->pos < end && inode_read_at (dir->inode, &e, sizeof e,
+				h.start + dir->pos) == sizeof e) {
 		dir->pos += sizeof e;
 		if (e.in_use) {
 			strlcpy (name, e.name, NAME_MAX + 1);
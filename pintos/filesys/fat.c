@@ -1,8 +1,13 @@
 #include "filesys/fat.h"
+#include <bitmap.h>
+#include <debug.h>
 #include "devices/disk.h"
+#include "devices/timer.h"
+#include "filesys/buffer_cache.h"
 #include "filesys/filesys.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -22,14 +27,26 @@ struct fat_fs {
 	unsigned int *fat;
 	unsigned int fat_length;
 	disk_sector_t data_start;
-	cluster_t last_clst;
+	cluster_t last_clst;        /* Where the search for a free cluster resumes. */
 	struct lock write_lock;
+	struct bitmap *used;        /* One bit per cluster, set if in use. */
+	struct bitmap *loaded;      /* One bit per FAT sector, set if read in. */
+	struct bitmap *dirty;       /* One bit per FAT sector, set if changed. */
+	bool boot_dirty;            /* Boot sector not on the disk yet. */
 };
 
+/* FAT entries in a FAT sector. */
+#define FAT_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (cluster_t))
+
+/* Period of the thread that writes changed FAT sectors back. */
+#define FAT_SYNC_MS 5000
+
 static struct fat_fs *fat_fs;
 
 void fat_boot_create (void);
 void fat_fs_init (void);
+static void fat_tables_create (bool loaded);
+static void fat_syncd (void *aux);
 
 void
 fat_init (void) {
@@ -51,65 +68,55 @@ fat_init (void) {
 	fat_fs_init ();
 }
 
+/* Sets up the FAT of the disk for use.  Its sectors are read in when
+ * they are first used, see fat_load(), so mounting reads none of them,
+ * and only the ones that changed are written back. */
 void
 fat_open (void) {
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
+	/* Right after fat_create() the FAT in memory is already complete. */
 	if (fat_fs->fat == NULL)
-		PANIC ("FAT load failed");
-
-	// Load FAT directly from the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_read = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_read;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i,
-			           buffer + bytes_read);
-			bytes_read += DISK_SECTOR_SIZE;
-		} else {
-			uint8_t *bounce = malloc (DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT load failed");
-			disk_read (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			memcpy (buffer + bytes_read, bounce, bytes_left);
-			bytes_read += bytes_left;
-			free (bounce);
-		}
-	}
+		fat_tables_create (false);
+	thread_create ("fatsync", PRI_DEFAULT, fat_syncd, NULL);
 }
 
+/* Writes the changed parts of the FAT to the disk. */
 void
 fat_close (void) {
-	// Write FAT boot sector
-	uint8_t *bounce = calloc (1, DISK_SECTOR_SIZE);
-	if (bounce == NULL)
-		PANIC ("FAT close failed");
-	memcpy (bounce, &fat_fs->bs, sizeof (fat_fs->bs));
-	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
-	free (bounce);
+	fat_sync ();
+}
 
-	// Write FAT directly to the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
-		}
+/* Writes the boot sector, if it is new, and the FAT sectors changed
+ * since they were last written to the disk. */
+void
+fat_sync (void) {
+	lock_acquire (&fat_fs->write_lock);
+	if (fat_fs->boot_dirty) {
+		uint8_t *bounce = calloc (1, DISK_SECTOR_SIZE);
+		if (bounce == NULL)
+			PANIC ("FAT sync failed");
+		memcpy (bounce, &fat_fs->bs, sizeof (fat_fs->bs));
+		disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
+		free (bounce);
+		fat_fs->boot_dirty = false;
+	}
+	for (size_t i = bitmap_scan (fat_fs->dirty, 0, 1, true);
+	     i != BITMAP_ERROR; i = bitmap_scan (fat_fs->dirty, i + 1, 1, true)) {
+		disk_write (filesys_disk, fat_fs->bs.fat_start + i,
+		            fat_fs->fat + i * FAT_PER_SECTOR);
+		bitmap_reset (fat_fs->dirty, i);
+	}
+	lock_release (&fat_fs->write_lock);
+}
+
+/* Writes the FAT back every FAT_SYNC_MS, after the cached data blocks,
+ * so that the FAT on disk never links in a cluster whose contents are
+ * still only in memory. */
+static void
+fat_syncd (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep ((int64_t) FAT_SYNC_MS * TIMER_FREQ / 1000);
+		buffer_cache_flush ();
+		fat_sync ();
 	}
 }
 
@@ -120,9 +127,7 @@ fat_create (void) {
 	fat_fs_init ();
 
 	// Create FAT table
-	fat_fs->fat = calloc (fat_fs->fat_length, sizeof (cluster_t));
-	if (fat_fs->fat == NULL)
-		PANIC ("FAT creation failed");
+	fat_tables_create (true);
 
 	// Set up ROOT_DIR_CLST
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
@@ -148,11 +153,102 @@ fat_boot_create (void) {
 	    .fat_sectors = fat_sectors,
 	    .root_dir_cluster = ROOT_DIR_CLUSTER,
 	};
+	fat_fs->boot_dirty = true;
 }
 
 void
 fat_fs_init (void) {
-	/* TODO: Your code goes here. */
+	/* Cluster 0 stands for "none", so cluster N is data sector N - 1. */
+	unsigned int per_sector = DISK_SECTOR_SIZE / sizeof (cluster_t);
+	unsigned int data_sectors =
+	    fat_fs->bs.total_sectors - fat_fs->bs.fat_start - fat_fs->bs.fat_sectors;
+
+	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;
+	fat_fs->fat_length = data_sectors / SECTORS_PER_CLUSTER + 1;
+	if (fat_fs->fat_length > fat_fs->bs.fat_sectors * per_sector)
+		fat_fs->fat_length = fat_fs->bs.fat_sectors * per_sector;
+	fat_fs->last_clst = ROOT_DIR_CLUSTER + 1;
+	lock_init (&fat_fs->write_lock);
+}
+
+/* Allocates the FAT in memory and the bitmaps that go with it.  LOADED
+ * is true if the FAT in memory is the whole FAT already, as for a new
+ * one, which then goes to the disk in full.  Otherwise the FAT sectors
+ * are read in as they are used, and until then their clusters look free
+ * in the used bitmap. */
+static void
+fat_tables_create (bool loaded) {
+	size_t sectors = fat_fs->bs.fat_sectors;
+
+	fat_fs->fat = calloc (sectors * FAT_PER_SECTOR, sizeof (cluster_t));
+	fat_fs->used = bitmap_create (fat_fs->fat_length);
+	fat_fs->loaded = bitmap_create (sectors);
+	fat_fs->dirty = bitmap_create (sectors);
+	if (fat_fs->fat == NULL || fat_fs->used == NULL
+	    || fat_fs->loaded == NULL || fat_fs->dirty == NULL)
+		PANIC ("FAT load failed");
+	bitmap_set_all (fat_fs->loaded, loaded);
+	bitmap_set_all (fat_fs->dirty, loaded);
+	bitmap_mark (fat_fs->used, 0);
+}
+
+/* Reads FAT sector SECTOR in unless it already is, and brings the bits of
+ * its clusters in the used bitmap up to date.  Needs write_lock. */
+static void
+fat_load (size_t sector) {
+	cluster_t first = sector * FAT_PER_SECTOR;
+
+	if (bitmap_test (fat_fs->loaded, sector))
+		return;
+	disk_read (filesys_disk, fat_fs->bs.fat_start + sector,
+	           fat_fs->fat + first);
+	for (cluster_t clst = first == 0 ? 1 : first;
+	     clst < first + FAT_PER_SECTOR && clst < fat_fs->fat_length; clst++)
+		bitmap_set (fat_fs->used, clst, fat_fs->fat[clst] != 0);
+	bitmap_mark (fat_fs->loaded, sector);
+}
+
+/* Sets the FAT entry of CLST to VAL.  Needs write_lock. */
+static void
+fat_set (cluster_t clst, cluster_t val) {
+	fat_load (clst / FAT_PER_SECTOR);
+	fat_fs->fat[clst] = val;
+	bitmap_mark (fat_fs->dirty, clst / FAT_PER_SECTOR);
+	bitmap_set (fat_fs->used, clst, val != 0);
+}
+
+/* Picks a free cluster for a chain that ends in CLST, or starts there if
+ * CLST is 0.  The cluster right after CLST keeps the file contiguous, so
+ * it is taken if free; otherwise the search goes on from where the last
+ * one stopped.  Returns 0 if the disk is full.  Needs write_lock. */
+static cluster_t
+fat_pick_free (cluster_t clst) {
+	size_t start = fat_fs->last_clst;
+	bool wrapped = false;
+
+	if (clst != 0 && clst + 1 < fat_fs->fat_length) {
+		fat_load ((clst + 1) / FAT_PER_SECTOR);
+		if (!bitmap_test (fat_fs->used, clst + 1))
+			return clst + 1;
+	}
+
+	for (;;) {
+		size_t found = bitmap_scan (fat_fs->used, start, 1, false);
+
+		if (found == BITMAP_ERROR) {
+			if (wrapped)
+				return 0;
+			wrapped = true;
+			start = 1;
+			continue;
+		}
+
+		/* Clusters of FAT sectors not read in yet only look free. */
+		fat_load (found / FAT_PER_SECTOR);
+		if (!bitmap_test (fat_fs->used, found))
+			return found;
+		start = found + 1;
+	}
 }
 
 /*----------------------------------------------------------------------------*/
@@ -164,30 +260,76 @@ fat_fs_init (void) {
  * Returns 0 if fails to allocate a new cluster. */
 cluster_t
 fat_create_chain (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	cluster_t new;
+
+	ASSERT (clst < fat_fs->fat_length);
+
+	lock_acquire (&fat_fs->write_lock);
+	new = fat_pick_free (clst);
+	if (new != 0) {
+		fat_set (new, EOChain);
+		if (clst != 0)
+			fat_set (clst, new);
+		fat_fs->last_clst = new + 1 < fat_fs->fat_length ? new + 1 : 1;
+	}
+	lock_release (&fat_fs->write_lock);
+	return new;
 }
 
 /* Remove the chain of clusters starting from CLST.
  * If PCLST is 0, assume CLST as the start of the chain. */
 void
 fat_remove_chain (cluster_t clst, cluster_t pclst) {
-	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
+	if (pclst != 0)
+		fat_set (pclst, EOChain);
+	while (clst != 0 && clst != EOChain) {
+		cluster_t next;
+
+		ASSERT (clst < fat_fs->fat_length);
+		fat_load (clst / FAT_PER_SECTOR);
+		next = fat_fs->fat[clst];
+		fat_set (clst, 0);
+		clst = next;
+	}
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Update a value in the FAT table. */
 void
 fat_put (cluster_t clst, cluster_t val) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst != 0 && clst < fat_fs->fat_length);
+
+	lock_acquire (&fat_fs->write_lock);
+	fat_set (clst, val);
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Fetch a value in the FAT table. */
 cluster_t
 fat_get (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	cluster_t val;
+
+	ASSERT (clst != 0 && clst < fat_fs->fat_length);
+	/* The loaded bitmap shares words with bits that fat_load() sets for
+	 * other sectors, so it is only read under write_lock. */
+	lock_acquire (&fat_fs->write_lock);
+	fat_load (clst / FAT_PER_SECTOR);
+	val = fat_fs->fat[clst];
+	lock_release (&fat_fs->write_lock);
+	return val;
 }
 
 /* Covert a cluster # to a sector number. */
 disk_sector_t
 cluster_to_sector (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst != 0 && clst < fat_fs->fat_length);
+	return fat_fs->data_start + (clst - 1) * SECTORS_PER_CLUSTER;
+}
+
+/* Covert a sector number in the data area to its cluster #. */
+cluster_t
+sector_to_cluster (disk_sector_t sector) {
+	ASSERT (sector >= fat_fs->data_start);
+	return (sector - fat_fs->data_start) / SECTORS_PER_CLUSTER + 1;
 }
@@ -1,13 +1,36 @@
 #include "filesys/file.h"
 #include <debug.h>
+#include "devices/disk.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#ifdef VM
+#include "filesys/page_cache.h"
+
+/* With VM, file data goes through the page cache, which mmap shares,
+ * and is read ahead into it. */
+#define data_read_at page_cache_read
+#define data_write_at page_cache_write
+#define data_readahead page_cache_readahead
+#else
+#define data_read_at inode_read_at
+#define data_write_at inode_write_at
+#define data_readahead inode_readahead
+#endif
+
+/* Readahead window of a file, in sectors.  It opens at RA_MIN_SECTORS on
+ * the first sequential read and doubles on each one after, up to
+ * RA_MAX_SECTORS.  A seek closes it. */
+#define RA_MIN_SECTORS 2
+#define RA_MAX_SECTORS 16
 
 /* An open file. */
 struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	off_t ra_next;              /* Where a sequential read starts. */
+	off_t ra_end;               /* Readahead issued up to here. */
+	int ra_window;              /* Readahead window, 0 if closed. */
 };
 
 /* Opens a file for the given INODE, of which it takes ownership,
@@ -71,8 +94,29 @@ file_get_inode (struct file *file) {
  * Advances FILE's position by the number of bytes read. */
 off_t
 file_read (struct file *file, void *buffer, off_t size) {
-	off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+	off_t bytes_read;
+
+	if (file->pos != file->ra_next) {
+		file->ra_window = 0;
+		file->ra_end = 0;
+	} else if (file->ra_window == 0)
+		file->ra_window = RA_MIN_SECTORS;
+	else if (file->ra_window < RA_MAX_SECTORS)
+		file->ra_window *= 2;
+
+	bytes_read = data_read_at (file->inode, buffer, size, file->pos);
 	file->pos += bytes_read;
+	file->ra_next = file->pos;
+
+	/* Keep the window ahead of the reader. */
+	if (file->ra_window > 0) {
+		off_t from = file->ra_end > file->pos ? file->ra_end : file->pos;
+		off_t to = file->pos + file->ra_window * DISK_SECTOR_SIZE;
+		if (from < to) {
+			data_readahead (file->inode, from, to);
+			file->ra_end = to;
+		}
+	}
 	return bytes_read;
 }
 
@@ -83,19 +127,18 @@ file_read (struct file *file, void *buffer, off_t size) {
  * The file's current position is unaffected. */
 off_t
 file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) {
-	return inode_read_at (file->inode, buffer, size, file_ofs);
+	return data_read_at (file->inode, buffer, size, file_ofs);
 }
 
 /* Writes SIZE bytes from BUFFER into FILE,
  * starting at the file's current position.
  * Returns the number of bytes actually written,
- * which may be less than SIZE if end of file is reached.
- * (Normally we'd grow the file in that case, but file growth is
- * not yet implemented.)
+ * which may be less than SIZE if the disk is full.
+ * Writing past end of file grows the file.
  * Advances FILE's position by the number of bytes read. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) {
-	off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+	off_t bytes_written = data_write_at (file->inode, buffer, size, file->pos);
 	file->pos += bytes_written;
 	return bytes_written;
 }
@@ -103,14 +146,13 @@ file_write (struct file *file, const void *buffer, off_t size) {
 /* Writes SIZE bytes from BUFFER into FILE,
  * starting at offset FILE_OFS in the file.
  * Returns the number of bytes actually written,
- * which may be less than SIZE if end of file is reached.
- * (Normally we'd grow the file in that case, but file growth is
- * not yet implemented.)
+ * which may be less than SIZE if the disk is full.
+ * Writing past end of file grows the file.
  * The file's current position is unaffected. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
 		off_t file_ofs) {
-	return inode_write_at (file->inode, buffer, size, file_ofs);
+	return data_write_at (file->inode, buffer, size, file_ofs);
 }
 
 /* Prevents write operations on FILE's underlying inode
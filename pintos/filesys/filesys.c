@@ -2,16 +2,26 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/buffer_cache.h"
+#include "filesys/dcache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "devices/disk.h"
+#ifdef EFILESYS
+#include "filesys/fat.h"
+#endif
+#ifdef VM
+#include "filesys/page_cache.h"
+#endif
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
 
 static void do_format (void);
+static bool inode_sector_allocate (disk_sector_t *);
+static void inode_sector_release (disk_sector_t);
 
 /* Initializes the file system module.
  * If FORMAT is true, reformats the file system. */
@@ -21,6 +31,8 @@ filesys_init (bool format) {
 	if (filesys_disk == NULL)
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
+	buffer_cache_init ();
+	dcache_init ();
 	inode_init ();
 
 #ifdef EFILESYS
@@ -45,6 +57,12 @@ filesys_init (bool format) {
  * to disk. */
 void
 filesys_done (void) {
+#ifdef VM
+	page_cache_flush ();
+#endif
+	/* Cached data goes out before the FAT that links it in, as in
+	 * fat_syncd(). */
+	buffer_cache_flush ();
 	/* Original FS */
 #ifdef EFILESYS
 	fat_close ();
@@ -62,11 +80,11 @@ filesys_create (const char *name, off_t initial_size) {
 	disk_sector_t inode_sector = 0;
 	struct dir *dir = dir_open_root ();
 	bool success = (dir != NULL
-			&& free_map_allocate (1, &inode_sector)
+			&& inode_sector_allocate (&inode_sector)
 			&& inode_create (inode_sector, initial_size)
 			&& dir_add (dir, name, inode_sector));
 	if (!success && inode_sector != 0)
-		free_map_release (inode_sector, 1);
+		inode_sector_release (inode_sector);
 	dir_close (dir);
 
 	return success;
@@ -102,6 +120,32 @@ filesys_remove (const char *name) {
 	return success;
 }
 
+/* Allocates a sector for a new inode and stores it in *SECTORP.
+ * Returns false if the disk is full. */
+static bool
+inode_sector_allocate (disk_sector_t *sectorp) {
+#ifdef EFILESYS
+	cluster_t clst = fat_create_chain (0);
+
+	if (clst == 0)
+		return false;
+	*sectorp = cluster_to_sector (clst);
+	return true;
+#else
+	return free_map_allocate (1, sectorp);
+#endif
+}
+
+/* Frees SECTOR, allocated by inode_sector_allocate(). */
+static void
+inode_sector_release (disk_sector_t sector) {
+#ifdef EFILESYS
+	fat_remove_chain (sector_to_cluster (sector), 0);
+#else
+	free_map_release (sector, 1);
+#endif
+}
+
 /* Formats the file system. */
 static void
 do_format (void) {
@@ -110,6 +154,8 @@ do_format (void) {
 #ifdef EFILESYS
 	/* Create FAT and save it to the disk. */
 	fat_create ();
+	if (!dir_create (cluster_to_sector (ROOT_DIR_CLUSTER), 16))
+		PANIC ("root directory creation failed");
 	fat_close ();
 #else
 	free_map_create ();
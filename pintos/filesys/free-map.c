@@ -24,7 +24,20 @@ free_map_init (void) {
  * available. */
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
-	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+	return free_map_allocate_near (0, cnt, sectorp);
+}
+
+/* Like free_map_allocate(), but looks at HINT and the sectors after it
+ * first, so that a growing file can continue where it ends. */
+bool
+free_map_allocate_near (disk_sector_t hint, size_t cnt,
+		disk_sector_t *sectorp) {
+	disk_sector_t sector = BITMAP_ERROR;
+
+	if (hint < bitmap_size (free_map))
+		sector = bitmap_scan_and_flip (free_map, hint, cnt, false);
+	if (sector == BITMAP_ERROR && hint > 0)
+		sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
 	if (sector != BITMAP_ERROR
 			&& free_map_file != NULL
 			&& !bitmap_write (free_map, free_map_file)) {
@@ -3,22 +3,73 @@
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include "filesys/buffer_cache.h"
+#ifdef EFILESYS
+#include "filesys/fat.h"
+#endif
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+#ifdef EFILESYS
+/* Bytes in a cluster, clusters between two checkpoints of the chain
+ * cache, and positions on the chain it remembers besides. */
+#define CLUSTER_SIZE (DISK_SECTOR_SIZE * SECTORS_PER_CLUSTER)
+#define CKPT_STRIDE 32
+#define CURSOR_CNT 4
+
 /* On-disk inode.
- * Must be exactly DISK_SECTOR_SIZE bytes long. */
+ * Must be exactly DISK_SECTOR_SIZE bytes long.
+ * The data is the cluster chain that starts at START, or 0 if the file
+ * has no data. */
 struct inode_disk {
-	disk_sector_t start;                /* First data sector. */
+	cluster_t start;                    /* First data cluster. */
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
 	uint32_t unused[125];               /* Not used. */
 };
 
+/* Positions already resolved on the cluster chain of an open inode.
+ * Finding cluster N of a file means following the chain N times from its
+ * start, so each lookup starts from the nearest position at or before N
+ * known here instead: one of the cursors, the last few clusters looked
+ * up, which make sequential access one step per cluster, or one of the
+ * checkpoints, every CKPT_STRIDE-th cluster, which bound a random seek.
+ * The chain only ever grows at its end, so nothing here goes stale. */
+struct chain_cache {
+	size_t cur_idx[CURSOR_CNT];         /* Cluster numbers within the file. */
+	cluster_t cur_clst[CURSOR_CNT];     /* Their clusters, 0 if unused. */
+	unsigned cur_next;                  /* Cursor to reuse next. */
+	cluster_t *ckpt;                    /* Cluster (I + 1) * CKPT_STRIDE. */
+	size_t ckpt_cnt;                    /* Checkpoints known. */
+	size_t ckpt_cap;                    /* Room in CKPT. */
+};
+#else
+/* Data sectors an inode points to directly, sector numbers in an index
+ * sector, and data sectors a file can have at most. */
+#define DIRECT_CNT 124
+#define PTRS_PER_SECTOR (DISK_SECTOR_SIZE / sizeof (disk_sector_t))
+#define MAX_SECTORS (DIRECT_CNT + PTRS_PER_SECTOR \
+		+ PTRS_PER_SECTOR * PTRS_PER_SECTOR)
+
+/* On-disk inode.
+ * Must be exactly DISK_SECTOR_SIZE bytes long.
+ * Data sector N of the file is direct[N] for the first DIRECT_CNT, then
+ * comes from the index sector INDIRECT, then from the index sectors that
+ * DOUBLY_INDIRECT points to.  A sector number of 0 means none. */
+struct inode_disk {
+	off_t length;                       /* File size in bytes. */
+	unsigned magic;                     /* Magic number. */
+	disk_sector_t direct[DIRECT_CNT];   /* First data sectors. */
+	disk_sector_t indirect;             /* Index of the next ones. */
+	disk_sector_t doubly_indirect;      /* Index of indexes of the rest. */
+};
+#endif
+
 /* Returns the number of sectors to allocate for an inode SIZE
  * bytes long. */
 static inline size_t
@@ -33,9 +84,302 @@ struct inode {
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	struct lock lock;                   /* Serializes growing the file. */
 	struct inode_disk data;             /* Inode content. */
+#ifdef EFILESYS
+	struct chain_cache chain;           /* Guarded by LOCK. */
+#endif
 };
 
+static char zeros[DISK_SECTOR_SIZE];
+
+#ifdef EFILESYS
+/* Returns the number of clusters to allocate for an inode SIZE
+ * bytes long. */
+static inline size_t
+bytes_to_clusters (off_t size) {
+	return DIV_ROUND_UP (size, CLUSTER_SIZE);
+}
+
+/* Adds CLST as the next checkpoint of C, if there is memory for it. */
+static void
+chain_checkpoint (struct chain_cache *c, cluster_t clst) {
+	if (c->ckpt_cnt == c->ckpt_cap) {
+		size_t cap = c->ckpt_cap > 0 ? c->ckpt_cap * 2 : 8;
+		cluster_t *ckpt = realloc (c->ckpt, cap * sizeof *ckpt);
+
+		if (ckpt == NULL)
+			return;
+		c->ckpt = ckpt;
+		c->ckpt_cap = cap;
+	}
+	c->ckpt[c->ckpt_cnt++] = clst;
+}
+
+/* Returns cluster N of INODE, which must have one.  Needs INODE's
+ * lock. */
+static cluster_t
+chain_lookup (struct inode *inode, size_t n) {
+	struct chain_cache *c = &inode->chain;
+	size_t k = n / CKPT_STRIDE < c->ckpt_cnt ? n / CKPT_STRIDE : c->ckpt_cnt;
+	size_t idx = k * CKPT_STRIDE;
+	cluster_t clst = k > 0 ? c->ckpt[k - 1] : inode->data.start;
+	int from = -1;
+
+	for (int i = 0; i < CURSOR_CNT; i++)
+		if (c->cur_clst[i] != 0 && c->cur_idx[i] <= n
+				&& c->cur_idx[i] >= idx) {
+			idx = c->cur_idx[i];
+			clst = c->cur_clst[i];
+			from = i;
+		}
+
+	while (idx < n) {
+		clst = fat_get (clst);
+		ASSERT (clst != 0 && clst != EOChain);
+		if (++idx == (c->ckpt_cnt + 1) * CKPT_STRIDE)
+			chain_checkpoint (c, clst);
+	}
+
+	/* Move the cursor the walk started from, so that each sequential
+	 * reader keeps one of its own; otherwise take the next in turn. */
+	if (from < 0) {
+		from = c->cur_next;
+		c->cur_next = (c->cur_next + 1) % CURSOR_CNT;
+	}
+	c->cur_idx[from] = n;
+	c->cur_clst[from] = clst;
+	return clst;
+}
+
+/* Grows the file DISK, whose last cluster is TAIL, or 0 if it has none,
+ * to LENGTH bytes, with zeros.  Each new cluster is the one right after
+ * the last where that is free, so that the file stays contiguous where
+ * the disk allows.  On failure DISK is left as it was. */
+static bool
+chain_grow (struct inode_disk *disk, cluster_t tail, off_t length) {
+	size_t have = bytes_to_clusters (disk->length);
+	size_t want = bytes_to_clusters (length);
+	cluster_t old_tail = tail;
+	cluster_t first = 0;
+
+	for (; have < want; have++) {
+		cluster_t clst = fat_create_chain (tail);
+
+		if (clst == 0) {
+			if (first != 0)
+				fat_remove_chain (first, old_tail);
+			return false;
+		}
+		if (first == 0)
+			first = clst;
+		for (size_t i = 0; i < SECTORS_PER_CLUSTER; i++)
+			buffer_cache_write (cluster_to_sector (clst) + i, zeros, 0,
+					DISK_SECTOR_SIZE);
+		tail = clst;
+	}
+	if (disk->start == 0)
+		disk->start = first;
+	if (length > disk->length)
+		disk->length = length;
+	return true;
+}
+
+/* Grows the new file DISK, which has no data yet, to LENGTH bytes, with
+ * zeros.  On failure DISK is left as it was. */
+static bool
+inode_disk_grow (struct inode_disk *disk, off_t length) {
+	ASSERT (disk->start == 0);
+	return chain_grow (disk, 0, length);
+}
+
+/* Grows INODE to LENGTH bytes, with zeros.  Needs INODE's lock. */
+static bool
+inode_grow (struct inode *inode, off_t length) {
+	size_t have = bytes_to_clusters (inode->data.length);
+
+	return chain_grow (&inode->data,
+			have > 0 ? chain_lookup (inode, have - 1) : 0, length);
+}
+
+/* Frees the sector of INODE and its data. */
+static void
+inode_release (struct inode *inode) {
+	fat_remove_chain (sector_to_cluster (inode->sector), 0);
+	if (inode->data.start != 0)
+		fat_remove_chain (inode->data.start, 0);
+}
+
+/* Returns the disk sector that contains byte offset POS within
+ * INODE.
+ * Returns -1 if INODE does not contain data for a byte at offset
+ * POS. */
+static disk_sector_t
+byte_to_sector (struct inode *inode, off_t pos) {
+	disk_sector_t sector = -1;
+
+	ASSERT (inode != NULL);
+	lock_acquire (&inode->lock);
+	if (pos < inode->data.length)
+		sector = cluster_to_sector (chain_lookup (inode, pos / CLUSTER_SIZE))
+			+ pos % CLUSTER_SIZE / DISK_SECTOR_SIZE;
+	lock_release (&inode->lock);
+	return sector;
+}
+#else
+
+/* Returns entry I of the index sector SECTOR. */
+static disk_sector_t
+index_get (disk_sector_t sector, size_t i) {
+	disk_sector_t v;
+
+	buffer_cache_read (sector, &v, i * sizeof v, sizeof v);
+	return v;
+}
+
+/* Sets entry I of the index sector SECTOR to V. */
+static void
+index_put (disk_sector_t sector, size_t i, disk_sector_t v) {
+	buffer_cache_write (sector, &v, i * sizeof v, sizeof v);
+}
+
+/* Returns data sector N of the file DISK, which must have one.  Takes at
+ * most two lookups in the buffer cache. */
+static disk_sector_t
+index_lookup (const struct inode_disk *disk, size_t n) {
+	if (n < DIRECT_CNT)
+		return disk->direct[n];
+	n -= DIRECT_CNT;
+	if (n < PTRS_PER_SECTOR)
+		return index_get (disk->indirect, n);
+	n -= PTRS_PER_SECTOR;
+	return index_get (index_get (disk->doubly_indirect, n / PTRS_PER_SECTOR),
+			n % PTRS_PER_SECTOR);
+}
+
+/* Points *SECTORP at a new, zeroed index sector unless it already points
+ * at one.  Returns false if the disk is full. */
+static bool
+index_alloc (disk_sector_t *sectorp) {
+	if (*sectorp != 0)
+		return true;
+	if (!free_map_allocate (1, sectorp))
+		return false;
+	buffer_cache_write (*sectorp, zeros, 0, DISK_SECTOR_SIZE);
+	return true;
+}
+
+/* Makes SECTOR data sector N of the file DISK, allocating the index
+ * sectors on the way.  Returns false if the disk is full. */
+static bool
+index_set (struct inode_disk *disk, size_t n, disk_sector_t sector) {
+	disk_sector_t child;
+
+	if (n < DIRECT_CNT) {
+		disk->direct[n] = sector;
+		return true;
+	}
+	n -= DIRECT_CNT;
+	if (n < PTRS_PER_SECTOR) {
+		if (!index_alloc (&disk->indirect))
+			return false;
+		index_put (disk->indirect, n, sector);
+		return true;
+	}
+	n -= PTRS_PER_SECTOR;
+	if (!index_alloc (&disk->doubly_indirect))
+		return false;
+	child = index_get (disk->doubly_indirect, n / PTRS_PER_SECTOR);
+	if (child == 0) {
+		if (!index_alloc (&child))
+			return false;
+		index_put (disk->doubly_indirect, n / PTRS_PER_SECTOR, child);
+	}
+	index_put (child, n % PTRS_PER_SECTOR, sector);
+	return true;
+}
+
+/* Frees data sectors [FROM, TO) of the file DISK, a run of adjacent
+ * sectors at a time, and the index sectors that only they used. */
+static void
+index_release (struct inode_disk *disk, size_t from, size_t to) {
+	disk_sector_t run_start = 0;
+	size_t run_len = 0;
+
+	for (size_t n = from; n < to; n++) {
+		disk_sector_t sector = index_lookup (disk, n);
+		if (run_len > 0 && sector == run_start + run_len) {
+			run_len++;
+			continue;
+		}
+		if (run_len > 0)
+			free_map_release (run_start, run_len);
+		run_start = sector;
+		run_len = 1;
+	}
+	if (run_len > 0)
+		free_map_release (run_start, run_len);
+
+	if (from <= DIRECT_CNT && disk->indirect != 0) {
+		free_map_release (disk->indirect, 1);
+		disk->indirect = 0;
+	}
+	if (disk->doubly_indirect != 0) {
+		size_t base = DIRECT_CNT + PTRS_PER_SECTOR;
+		size_t first = from > base
+			? DIV_ROUND_UP (from - base, PTRS_PER_SECTOR) : 0;
+
+		for (size_t i = first; i < PTRS_PER_SECTOR; i++) {
+			disk_sector_t child = index_get (disk->doubly_indirect, i);
+			if (child == 0)
+				break;
+			free_map_release (child, 1);
+			index_put (disk->doubly_indirect, i, 0);
+		}
+		if (from <= base) {
+			free_map_release (disk->doubly_indirect, 1);
+			disk->doubly_indirect = 0;
+		}
+	}
+}
+
+/* Grows the file DISK to LENGTH bytes, with zeros.  New data sectors are
+ * taken in runs as long as the free map has, looking first right after
+ * the last sector of the file, so that the file stays contiguous where
+ * the disk allows.  On failure DISK is left as it was. */
+static bool
+inode_disk_grow (struct inode_disk *disk, off_t length) {
+	size_t have = bytes_to_sectors (disk->length);
+	size_t old = have;
+	size_t want = bytes_to_sectors (length);
+
+	if (want > MAX_SECTORS)
+		return false;
+	while (have < want) {
+		disk_sector_t hint = have > 0 ? index_lookup (disk, have - 1) + 1 : 0;
+		disk_sector_t start;
+		size_t run = want - have;
+
+		while (!free_map_allocate_near (hint, run, &start))
+			if ((run /= 2) == 0) {
+				index_release (disk, old, have);
+				return false;
+			}
+		for (size_t i = 0; i < run; i++) {
+			if (!index_set (disk, have, start + i)) {
+				free_map_release (start + i, run - i);
+				index_release (disk, old, have);
+				return false;
+			}
+			buffer_cache_write (start + i, zeros, 0, DISK_SECTOR_SIZE);
+			have++;
+		}
+	}
+	if (length > disk->length)
+		disk->length = length;
+	return true;
+}
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
@@ -44,19 +388,47 @@ static disk_sector_t
 byte_to_sector (const struct inode *inode, off_t pos) {
 	ASSERT (inode != NULL);
 	if (pos < inode->data.length)
-		return inode->data.start + pos / DISK_SECTOR_SIZE;
+		return index_lookup (&inode->data, pos / DISK_SECTOR_SIZE);
 	else
 		return -1;
 }
 
-/* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
-static struct list open_inodes;
+/* Grows INODE to LENGTH bytes, with zeros.  Needs INODE's lock. */
+static bool
+inode_grow (struct inode *inode, off_t length) {
+	return inode_disk_grow (&inode->data, length);
+}
+
+/* Frees the sector of INODE and its data. */
+static void
+inode_release (struct inode *inode) {
+	free_map_release (inode->sector, 1);
+	index_release (&inode->data, 0, bytes_to_sectors (inode->data.length));
+}
+#endif
+
+/* Open inodes, so that opening a single inode twice returns the same
+ * `struct inode'.  Hashed by sector into buckets, each with a lock of its
+ * own that also guards the open counts of the inodes in it. */
+#define INODE_BUCKETS 64
+static struct inode_bucket {
+	struct list inodes;
+	struct lock lock;
+} open_inodes[INODE_BUCKETS];
+
+/* Returns the bucket of the inode in SECTOR. */
+static struct inode_bucket *
+inode_bucket (disk_sector_t sector) {
+	return &open_inodes[sector % INODE_BUCKETS];
+}
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
-	list_init (&open_inodes);
+	for (size_t i = 0; i < INODE_BUCKETS; i++) {
+		list_init (&open_inodes[i].inodes);
+		lock_init (&open_inodes[i].lock);
+	}
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -77,18 +449,9 @@ inode_create (disk_sector_t sector, off_t length) {
 
 	disk_inode = calloc (1, sizeof *disk_inode);
 	if (disk_inode != NULL) {
-		size_t sectors = bytes_to_sectors (length);
-		disk_inode->length = length;
 		disk_inode->magic = INODE_MAGIC;
-		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
-			if (sectors > 0) {
-				static char zeros[DISK_SECTOR_SIZE];
-				size_t i;
-
-				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
-			}
+		if (inode_disk_grow (disk_inode, length)) {
+			buffer_cache_write (sector, disk_inode, 0, DISK_SECTOR_SIZE);
 			success = true; 
 		} 
 		free (disk_inode);
@@ -101,39 +464,55 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
+	struct inode_bucket *bucket = inode_bucket (sector);
 	struct list_elem *e;
 	struct inode *inode;
 
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+	lock_acquire (&bucket->lock);
+	for (e = list_begin (&bucket->inodes); e != list_end (&bucket->inodes);
 			e = list_next (e)) {
 		inode = list_entry (e, struct inode, elem);
 		if (inode->sector == sector) {
-			inode_reopen (inode);
+			inode->open_cnt++;
+			lock_release (&bucket->lock);
 			return inode; 
 		}
 	}
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	if (inode == NULL) {
+		lock_release (&bucket->lock);
 		return NULL;
+	}
 
-	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
+	/* Initialize.  Others opening the inode meanwhile wait on the bucket
+	 * until it is read in. */
+	list_push_front (&bucket->inodes, &inode->elem);
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-	disk_read (filesys_disk, inode->sector, &inode->data);
+	lock_init (&inode->lock);
+#ifdef EFILESYS
+	memset (&inode->chain, 0, sizeof inode->chain);
+#endif
+	buffer_cache_read (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+	lock_release (&bucket->lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		struct inode_bucket *bucket = inode_bucket (inode->sector);
+
+		lock_acquire (&bucket->lock);
 		inode->open_cnt++;
+		lock_release (&bucket->lock);
+	}
 	return inode;
 }
 
@@ -148,22 +527,29 @@ inode_get_inumber (const struct inode *inode) {
  * If INODE was also a removed inode, frees its blocks. */
 void
 inode_close (struct inode *inode) {
+	struct inode_bucket *bucket;
+	bool last;
+
 	/* Ignore null pointer. */
 	if (inode == NULL)
 		return;
 
-	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
+	bucket = inode_bucket (inode->sector);
+	lock_acquire (&bucket->lock);
+	last = --inode->open_cnt == 0;
+	if (last)
 		list_remove (&inode->elem);
+	lock_release (&bucket->lock);
 
+	/* Release resources if this was the last opener. */
+	if (last) {
 		/* Deallocate blocks if removed. */
-		if (inode->removed) {
-			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
-		}
+		if (inode->removed)
+			inode_release (inode);
 
+#ifdef EFILESYS
+		free (inode->chain.ckpt);
+#endif
 		free (inode); 
 	}
 }
@@ -183,7 +569,6 @@ off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
-	uint8_t *bounce = NULL;
 
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
@@ -200,45 +585,53 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
-		} else {
-			/* Read sector into bounce buffer, then partially copy
-			 * into caller's buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-			disk_read (filesys_disk, sector_idx, bounce);
-			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-		}
+		buffer_cache_read (sector_idx, buffer + bytes_read, sector_ofs,
+				chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
-	free (bounce);
 
 	return bytes_read;
 }
 
+/* Starts reading the sectors of INODE that hold bytes [START, END) into
+ * the buffer cache in the background. */
+void
+inode_readahead (struct inode *inode, off_t start, off_t end) {
+	if (end > inode_length (inode))
+		end = inode_length (inode);
+	for (off_t ofs = ROUND_DOWN (start, DISK_SECTOR_SIZE); ofs < end;
+			ofs += DISK_SECTOR_SIZE)
+		buffer_cache_readahead (byte_to_sector (inode, ofs));
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
+ * A write past end of file extends the inode, with zeros up to OFFSET.
  * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+ * less than SIZE if the disk is full or an error occurs. */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+		off_t offset) {
+	if (inode->deny_write_cnt)
+		return 0;
+	return inode_writeback (inode, buffer, size, offset);
+}
+
+/* Writes like inode_write_at(), but also while writes to INODE are
+ * denied.  The page cache writes back with it data that was written
+ * before they were. */
+off_t
+inode_writeback (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
 
-	if (inode->deny_write_cnt)
-		return 0;
+	/* If this fails, write what fits. */
+	if (offset + size > inode_length (inode))
+		inode_extend (inode, offset + size);
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
@@ -255,38 +648,38 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
-		} else {
-			/* We need a bounce buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-
-			/* If the sector contains data before or after the chunk
-			   we're writing, then we need to read in the sector
-			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
-			else
-				memset (bounce, 0, DISK_SECTOR_SIZE);
-			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
-		}
+		/* The cache reads the sector first unless the chunk covers
+		 * all of it. */
+		buffer_cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+				chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
-	free (bounce);
 
 	return bytes_written;
 }
 
+/* Grows INODE to LENGTH bytes, with zeros, and writes the grown inode
+ * to disk.  Does nothing if INODE is that long already.  Returns false
+ * if the disk is full. */
+bool
+inode_extend (struct inode *inode, off_t length) {
+	bool success = true;
+
+	lock_acquire (&inode->lock);
+	if (length > inode->data.length) {
+		success = inode_grow (inode, length);
+		if (success)
+			buffer_cache_write (inode->sector, &inode->data, 0,
+					DISK_SECTOR_SIZE);
+	}
+	lock_release (&inode->lock);
+	return success;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 	void
@@ -306,6 +699,18 @@ inode_allow_write (struct inode *inode) {
 	inode->deny_write_cnt--;
 }
 
+/* Returns true if writes to INODE are denied. */
+bool
+inode_write_denied (const struct inode *inode) {
+	return inode->deny_write_cnt > 0;
+}
+
+/* Returns true if INODE was removed and goes away on its last close. */
+bool
+inode_is_removed (const struct inode *inode) {
+	return inode->removed;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
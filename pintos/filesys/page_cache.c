@@ -1,50 +1,536 @@
-/* page_cache.c: Implementation of Page Cache (Buffer Cache). */
+/* page_cache.c: Implementation of Page Cache (Buffer Cache).
+ *
+ * File data is cached a page at a time, keyed by inode and page number,
+ * in frames of the frame table.  read() and write() copy through these
+ * frames and every mmap of a file page maps its frame, so both see the
+ * same bytes.  A page written either way is only marked dirty; the
+ * kworkerd thread writes dirty pages back in file order every
+ * writeback_ms, and eviction writes back what is left when it takes the
+ * frame.  Cached pages that nobody maps age on the clock like any other
+ * frame.
+ *
+ * page_cache_readahead() queues pages that a reader is expected to need
+ * soon, and the pc_readahead thread reads them into the cache, the same
+ * way the buffer cache reads sectors ahead without VM.
+ *
+ * The cache is protected by frame_lock.  Nothing is read or written
+ * under it: writebacks copy the pages and pin them first, then drop the
+ * lock for the disk. */
 
+#include "filesys/page_cache.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/buffer_cache.h"
+#include "filesys/filesys.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
-static bool page_cache_readahead (struct page *page, void *kva);
-static bool page_cache_writeback (struct page *page);
-static void page_cache_destroy (struct page *page);
-
-/* DO NOT MODIFY this struct */
-static const struct page_operations page_cache_op = {
-	.swap_in = page_cache_readahead,
-	.swap_out = page_cache_writeback,
-	.destroy = page_cache_destroy,
-	.type = VM_PAGE_CACHE,
+
+#ifdef VM
+/* Period of the writeback thread in milliseconds; 0 turns it off.  Set
+ * with "-wb=MS". */
+unsigned writeback_ms = 1000;
+
+/* Dirty pages gathered per writeback pass over the cache, and passes per
+ * wakeup at most. */
+#define WB_BATCH 16
+#define WB_MAX_BATCHES 64
+
+static struct hash pcache;      /* All cached pages, by inode and index. */
+static struct list pcache_list; /* The same pages, for writeback. */
+static bool pcache_ready;       /* Set once the frame table is up. */
+
+/* Pages waiting for the readahead thread, a ring buffer protected by
+ * ra_lock.  Each entry holds a reference to its inode.  Requests that do
+ * not fit are dropped. */
+#define RA_QUEUE_SIZE 32
+struct pcache_ra {
+	struct inode *inode;
+	off_t index;
 };
+static struct pcache_ra ra_queue[RA_QUEUE_SIZE];
+static size_t ra_head, ra_tail;     /* Next slot to fill, to take. */
+static struct lock ra_lock;
+static struct condition ra_ready;   /* The queue is not empty. */
 
-tid_t page_cache_workerd;
+static struct lock wb_lock;     /* Serializes users of the two below. */
+static struct pcache_page *wb_items[WB_BATCH];
+static void *wb_buf;            /* WB_BATCH pages of staging buffer. */
 
-/* The initializer of file vm */
-void
-pagecache_init (void) {
-	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
-}
+/* Statistics. */
+static unsigned long long pc_hits;      /* Lookups served from the cache. */
+static unsigned long long pc_misses;    /* Pages read in. */
+static unsigned long long pc_written;   /* Pages written back. */
+static unsigned long long pc_evicted;   /* Pages dropped for their frame. */
+static unsigned long long pc_readaheads;    /* Pages read ahead. */
 
-/* Initialize the page cache */
-bool
-page_cache_initializer (struct page *page, enum vm_type type, void *kva) {
-	/* Set up the handler */
-	page->operations = &page_cache_op;
+static void page_cache_kworkerd (void *aux);
+static void page_cache_readaheadd (void *aux);
 
+static uint64_t
+pcache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct pcache_page *p = hash_entry (e, struct pcache_page, elem);
+	return hash_bytes (&p->inode, sizeof p->inode) ^ hash_int (p->index);
 }
 
-/* Utilze the Swap in mechanism to implement readhead */
 static bool
-page_cache_readahead (struct page *page, void *kva) {
+pcache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct pcache_page *a = hash_entry (a_, struct pcache_page, elem);
+	const struct pcache_page *b = hash_entry (b_, struct pcache_page, elem);
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	return a->index < b->index;
+}
+
+/* Sets up the cache and starts the writeback and readahead threads.
+ * Called from vm_init(); until then files are read and written
+ * directly. */
+void
+page_cache_init (void) {
+	hash_init (&pcache, pcache_hash, pcache_less, NULL);
+	list_init (&pcache_list);
+	lock_init (&wb_lock);
+	lock_init (&ra_lock);
+	cond_init (&ra_ready);
+	wb_buf = palloc_get_multiple (PAL_ASSERT, WB_BATCH);
+	pcache_ready = true;
+	if (writeback_ms > 0)
+		thread_create ("kworkerd", PRI_DEFAULT, page_cache_kworkerd, NULL);
+	thread_create ("pc_readahead", PRI_DEFAULT, page_cache_readaheadd, NULL);
 }
 
-/* Utilze the Swap out mechanism to implement writeback */
+/* The free map is written while frame_lock is held, when a removed file
+ * goes away on eviction, so it always goes straight to its inode. */
 static bool
-page_cache_writeback (struct page *page) {
+pcache_bypass (struct inode *inode) {
+	return !pcache_ready || inode_get_inumber (inode) == FREE_MAP_SECTOR;
+}
+
+/* Returns the cached page INDEX of INODE, or NULL.  A page whose frame
+ * is being evicted is waited for, and is gone afterwards.  Needs
+ * frame_lock. */
+static struct pcache_page *
+pcache_lookup (struct inode *inode, off_t index) {
+	struct pcache_page probe;
+	struct hash_elem *e;
+	struct pcache_page *p;
+
+	probe.inode = inode;
+	probe.index = index;
+	for (;;) {
+		e = hash_find (&pcache, &probe.elem);
+		p = e != NULL ? hash_entry (e, struct pcache_page, elem) : NULL;
+		if (p == NULL || !p->frame->evicting)
+			return p;
+		vm_evict_wait ();
+	}
+}
+
+/* Keeps P where it is until page_cache_unpin().  Needs frame_lock. */
+static void
+pcache_pin (struct pcache_page *p) {
+	p->pins++;
+	p->frame->pinned = true;
+}
+
+/* Returns the number of bytes of page INDEX of INODE that lie in the
+ * file. */
+static size_t
+pcache_page_bytes (struct inode *inode, off_t index) {
+	off_t left = inode_length (inode) - index * PGSIZE;
+
+	if (left <= 0)
+		return 0;
+	return left < PGSIZE ? left : PGSIZE;
+}
+
+/* Returns the frame that caches page INDEX of INODE, reading it in first
+ * if it is not cached, evicting another page for it only if MAY_EVICT.
+ * The frame comes back pinned; release it with page_cache_unpin().
+ * Returns NULL if no frame could be had. */
+struct frame *
+page_cache_get (struct inode *inode, off_t index, bool may_evict) {
+	struct pcache_page *p;
+	struct frame *frame;
+	size_t read_bytes;
+
+	lock_acquire (&frame_lock);
+	p = pcache_lookup (inode, index);
+	if (p != NULL) {
+		pcache_pin (p);
+		pc_hits++;
+		lock_release (&frame_lock);
+		return p->frame;
+	}
+	lock_release (&frame_lock);
+
+	frame = vm_alloc_frame (may_evict);
+	if (frame == NULL)
+		return NULL;
+	p = malloc (sizeof *p);
+	if (p == NULL) {
+		vm_free_unused_frame (frame);
+		return NULL;
+	}
+	read_bytes = pcache_page_bytes (inode, index);
+	inode_read_at (inode, frame->kva, read_bytes, index * PGSIZE);
+	memset ((uint8_t *) frame->kva + read_bytes, 0, PGSIZE - read_bytes);
+
+	p->inode = inode_reopen (inode);
+	p->index = index;
+	p->frame = frame;
+	p->pins = 1;
+	p->dirty = false;
+	p->referenced = true;
+
+	/* Someone else may have read the same page meanwhile. */
+	lock_acquire (&frame_lock);
+	struct pcache_page *other = pcache_lookup (inode, index);
+	if (other != NULL)
+		pcache_pin (other);
+	else {
+		hash_insert (&pcache, &p->elem);
+		list_push_back (&pcache_list, &p->list_elem);
+		frame->pc = p;
+		pc_misses++;
+	}
+	lock_release (&frame_lock);
+
+	if (other == NULL)
+		return frame;
+	inode_close (p->inode);
+	free (p);
+	vm_free_unused_frame (frame);
+	return other->frame;
+}
+
+/* Undoes page_cache_get() on FRAME.  Needs frame_lock. */
+void
+page_cache_unpin (struct frame *frame) {
+	struct pcache_page *p = frame->pc;
+
+	ASSERT (p != NULL && p->pins > 0);
+	if (--p->pins == 0)
+		frame->pinned = false;
+}
+
+/* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET,
+ * through the page cache.  Returns the number of bytes actually read,
+ * which may be less than SIZE if memory runs out or end of file is
+ * reached. */
+off_t
+page_cache_read (struct inode *inode, void *buffer_, off_t size,
+		off_t offset) {
+	uint8_t *buffer = buffer_;
+	off_t bytes_read = 0;
+
+	if (pcache_bypass (inode))
+		return inode_read_at (inode, buffer, size, offset);
+
+	while (size > 0) {
+		off_t index = offset / PGSIZE;
+		int page_ofs = offset % PGSIZE;
+
+		/* Bytes left in inode, bytes left in page, lesser of the two. */
+		off_t inode_left = inode_length (inode) - offset;
+		int page_left = PGSIZE - page_ofs;
+		int min_left = inode_left < page_left ? inode_left : page_left;
+		int chunk_size = size < min_left ? size : min_left;
+		if (chunk_size <= 0)
+			break;
+
+		struct frame *frame = page_cache_get (inode, index, true);
+		if (frame == NULL)
+			break;
+		memcpy (buffer + bytes_read, (uint8_t *) frame->kva + page_ofs,
+				chunk_size);
+		lock_acquire (&frame_lock);
+		frame->pc->referenced = true;
+		page_cache_unpin (frame);
+		lock_release (&frame_lock);
+
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_read += chunk_size;
+	}
+	return bytes_read;
+}
+
+/* Asks the readahead thread to bring the pages of INODE that hold bytes
+ * [START, END) into the page cache.  They are read into the page cache
+ * only, not into the buffer cache as well, since reads of INODE are
+ * served from here. */
+void
+page_cache_readahead (struct inode *inode, off_t start, off_t end) {
+	if (pcache_bypass (inode)) {
+		inode_readahead (inode, start, end);
+		return;
+	}
+	if (end > inode_length (inode))
+		end = inode_length (inode);
+
+	for (off_t index = start / PGSIZE; index * PGSIZE < end; index++) {
+		lock_acquire (&frame_lock);
+		bool cached = pcache_lookup (inode, index) != NULL;
+		lock_release (&frame_lock);
+		if (cached)
+			continue;
+
+		lock_acquire (&ra_lock);
+		if (ra_head - ra_tail < RA_QUEUE_SIZE) {
+			struct pcache_ra *ra = &ra_queue[ra_head++ % RA_QUEUE_SIZE];
+			ra->inode = inode_reopen (inode);
+			ra->index = index;
+			cond_signal (&ra_ready, &ra_lock);
+		}
+		lock_release (&ra_lock);
+	}
+}
+
+/* Reads queued pages into the cache.  Like fault-around, it only uses
+ * frames that are free, and leaves the pages as not referenced, so a
+ * page that nobody reads after all is the first to go. */
+static void
+page_cache_readaheadd (void *aux UNUSED) {
+	for (;;) {
+		struct pcache_ra ra;
+
+		lock_acquire (&ra_lock);
+		while (ra_head == ra_tail)
+			cond_wait (&ra_ready, &ra_lock);
+		ra = ra_queue[ra_tail++ % RA_QUEUE_SIZE];
+		lock_release (&ra_lock);
+
+		lock_acquire (&frame_lock);
+		bool cached = pcache_lookup (ra.inode, ra.index) != NULL;
+		lock_release (&frame_lock);
+		if (!cached) {
+			struct frame *frame = page_cache_get (ra.inode, ra.index, false);
+			if (frame != NULL) {
+				lock_acquire (&frame_lock);
+				frame->pc->referenced = false;
+				page_cache_unpin (frame);
+				pc_readaheads++;
+				lock_release (&frame_lock);
+			}
+		}
+		inode_close (ra.inode);
+	}
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET, through
+ * the page cache.  The pages are written back to the disk later, but a
+ * write past end of file grows INODE right away.  Returns the number of
+ * bytes actually written, which may be less than SIZE if memory runs out
+ * or the disk is full, or 0 if writes to INODE are denied. */
+off_t
+page_cache_write (struct inode *inode, const void *buffer_, off_t size,
+		off_t offset) {
+	const uint8_t *buffer = buffer_;
+	off_t bytes_written = 0;
+
+	if (pcache_bypass (inode))
+		return inode_write_at (inode, buffer, size, offset);
+	if (inode_write_denied (inode))
+		return 0;
+
+	/* If this fails, write what fits. */
+	if (offset + size > inode_length (inode))
+		inode_extend (inode, offset + size);
+
+	while (size > 0) {
+		off_t index = offset / PGSIZE;
+		int page_ofs = offset % PGSIZE;
+
+		/* Bytes left in inode, bytes left in page, lesser of the two. */
+		off_t inode_left = inode_length (inode) - offset;
+		int page_left = PGSIZE - page_ofs;
+		int min_left = inode_left < page_left ? inode_left : page_left;
+		int chunk_size = size < min_left ? size : min_left;
+		if (chunk_size <= 0)
+			break;
+
+		struct frame *frame = page_cache_get (inode, index, true);
+		if (frame == NULL)
+			break;
+		memcpy ((uint8_t *) frame->kva + page_ofs, buffer + bytes_written,
+				chunk_size);
+		lock_acquire (&frame_lock);
+		frame->pc->dirty = true;
+		frame->pc->referenced = true;
+		page_cache_unpin (frame);
+		lock_release (&frame_lock);
+
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_written += chunk_size;
+	}
+	return bytes_written;
 }
 
-/* Destory the page_cache. */
+/* Folds the dirty bits of the pages mapping P into P->dirty, and clears
+ * them if CLEAR.  Needs frame_lock. */
 static void
-page_cache_destroy (struct page *page) {
+pcache_sync_dirty (struct pcache_page *p, bool clear) {
+	struct list *pages = &p->frame->pages;
+
+	for (struct list_elem *e = list_begin (pages); e != list_end (pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		vm_page_sync_dirty (page);
+		if (page->dirty)
+			p->dirty = true;
+		if (clear) {
+			if (page->owner->pml4 != NULL)
+				pml4_set_dirty (page->owner->pml4, page->va, false);
+			page->dirty = false;
+		}
+	}
+}
+
+/* Writes LEN bytes of file data from KVA at page INDEX of INODE.  A
+ * removed file is not written: its blocks are freed once the cache lets
+ * go of it.  Must not be called with frame_lock held. */
+static void
+pcache_write_page (struct inode *inode, off_t index, const void *kva,
+		size_t len) {
+	if (!inode_is_removed (inode))
+		inode_writeback (inode, kva, len, index * PGSIZE);
+}
+
+/* Writes back the page cached in FRAME and drops it from the cache, as
+ * eviction is taking FRAME.  Every page that mapped FRAME has been
+ * unmapped and has handed over its dirty bit.  Needs frame_lock, which is
+ * dropped for the write; FRAME is marked as being evicted meanwhile, so
+ * lookups wait instead of handing it out. */
+void
+page_cache_evict (struct frame *frame) {
+	struct pcache_page *p = frame->pc;
+
+	ASSERT (list_empty (&frame->pages) && p->pins == 0);
+	ASSERT (frame->evicting);
+	if (p->dirty) {
+		p->dirty = false;
+		pc_written++;
+		lock_release (&frame_lock);
+		pcache_write_page (p->inode, p->index, frame->kva,
+				pcache_page_bytes (p->inode, p->index));
+		lock_acquire (&frame_lock);
+	}
+	hash_delete (&pcache, &p->elem);
+	list_remove (&p->list_elem);
+	frame->pc = NULL;
+	inode_close (p->inode);
+	free (p);
+	pc_evicted++;
+}
+
+static bool
+wb_item_less (const struct pcache_page *a, const struct pcache_page *b) {
+	return a->inode != b->inode ? a->inode < b->inode : a->index < b->index;
+}
+
+/* Gathers up to WB_BATCH dirty pages and stages copies of them in file
+ * order under frame_lock, then drops the lock and writes each run of
+ * contiguous pages with a single call.  Dirty bits are cleared before the
+ * copy, so a write racing with us dirties the page again for the next
+ * pass.  The pages stay pinned, and their inodes open, until written, so
+ * eviction cannot write a newer copy that ours would then overwrite.
+ * Returns the number of pages written.  Needs wb_lock. */
+static size_t
+writeback_batch (void) {
+	size_t n = 0;
+
+	lock_acquire (&frame_lock);
+	for (struct list_elem *e = list_begin (&pcache_list);
+			e != list_end (&pcache_list) && n < WB_BATCH; e = list_next (e)) {
+		struct pcache_page *p = list_entry (e, struct pcache_page, list_elem);
+		if (p->frame->pinned)
+			continue;
+		pcache_sync_dirty (p, false);
+		if (!p->dirty)
+			continue;
+
+		/* Insertion sort by file position. */
+		size_t i = n++;
+		for (; i > 0 && wb_item_less (p, wb_items[i - 1]); i--)
+			wb_items[i] = wb_items[i - 1];
+		wb_items[i] = p;
+	}
+
+	for (size_t i = 0; i < n; i++) {
+		struct pcache_page *p = wb_items[i];
+		pcache_sync_dirty (p, true);
+		p->dirty = false;
+		memcpy ((uint8_t *) wb_buf + i * PGSIZE, p->frame->kva, PGSIZE);
+		pcache_pin (p);
+		inode_reopen (p->inode);
+	}
+	lock_release (&frame_lock);
+
+	for (size_t i = 0, j; i < n; i = j) {
+		struct pcache_page *p = wb_items[i];
+		size_t len = pcache_page_bytes (p->inode, p->index);
+		for (j = i + 1; j < n && wb_items[j]->inode == p->inode
+				&& len == (j - i) * PGSIZE
+				&& wb_items[j]->index == wb_items[j - 1]->index + 1; j++)
+			len += pcache_page_bytes (p->inode, wb_items[j]->index);
+		pcache_write_page (p->inode, p->index,
+				(uint8_t *) wb_buf + i * PGSIZE, len);
+	}
+
+	lock_acquire (&frame_lock);
+	for (size_t i = 0; i < n; i++)
+		page_cache_unpin (wb_items[i]->frame);
+	pc_written += n;
+	lock_release (&frame_lock);
+	for (size_t i = 0; i < n; i++)
+		inode_close (wb_items[i]->inode);
+	return n;
 }
 
-/* Worker thread for page cache */
+/* Worker thread for page cache.  Periodically writes dirty pages back to
+ * their files, so that eviction seldom has to, and on to the disk, as
+ * the buffer cache holds its writes until it needs the room. */
 static void
-page_cache_kworkerd (void *aux) {
+page_cache_kworkerd (void *aux UNUSED) {
+	for (;;) {
+		size_t n = WB_BATCH, total = 0;
+
+		timer_sleep ((int64_t) writeback_ms * TIMER_FREQ / 1000 + 1);
+		lock_acquire (&wb_lock);
+		for (int i = 0; i < WB_MAX_BATCHES && n == WB_BATCH; i++)
+			total += n = writeback_batch ();
+		lock_release (&wb_lock);
+		if (total > 0)
+			buffer_cache_flush ();
+	}
+}
+
+/* Writes every dirty page back, as the file system is shut down. */
+void
+page_cache_flush (void) {
+	if (!pcache_ready)
+		return;
+	lock_acquire (&wb_lock);
+	while (writeback_batch () > 0)
+		continue;
+	lock_release (&wb_lock);
+}
+
+/* Prints page cache statistics. */
+void
+page_cache_print_stats (void) {
+	printf ("Page cache: %llu hits, %llu misses (%llu read ahead), "
+			"%llu written back, %llu evicted\n", pc_hits, pc_misses,
+			pc_readaheads, pc_written, pc_evicted);
 }
+#endif /* VM */
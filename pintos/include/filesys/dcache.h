@@ -0,0 +1,18 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Names remembered by the cache. */
+#define DCACHE_SIZE 128
+
+void dcache_init (void);
+bool dcache_get (disk_sector_t dir, const char *name, disk_sector_t *sectorp);
+void dcache_put (disk_sector_t dir, const char *name, disk_sector_t sector);
+unsigned dcache_gen (void);
+void dcache_fill (disk_sector_t dir, const char *name, disk_sector_t sector,
+		unsigned gen);
+void dcache_print_stats (void);
+
+#endif /* filesys/dcache.h */
@@ -16,8 +16,13 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_writeback (struct inode *, const void *, off_t size, off_t offset);
+bool inode_extend (struct inode *, off_t length);
+void inode_readahead (struct inode *, off_t start, off_t end);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
+bool inode_write_denied (const struct inode *);
+bool inode_is_removed (const struct inode *);
 off_t inode_length (const struct inode *);
 
 #endif /* filesys/inode.h */
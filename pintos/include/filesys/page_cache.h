@@ -1,12 +1,41 @@
 #ifndef FILESYS_PAGE_CACHE_H
 #define FILESYS_PAGE_CACHE_H
-#include "vm/vm.h"
+#include <hash.h>
+#include <list.h>
+#include "filesys/off_t.h"
 
 struct page;
+struct frame;
+struct inode;
 enum vm_type;
 
 struct page_cache {};
 
+/* A page of file data in the page cache.  It lives in a frame of the
+ * frame table, which read() and write() copy through and which every
+ * mmap of the page maps.  Protected by frame_lock. */
+struct pcache_page {
+	struct hash_elem elem;      /* In the page cache. */
+	struct list_elem list_elem; /* In the writeback list. */
+	struct inode *inode;        /* File, with a reference held. */
+	off_t index;                /* Page number within INODE. */
+	struct frame *frame;        /* Frame holding the data. */
+	unsigned pins;              /* Users copying in or out right now. */
+	bool dirty;                 /* Written since the last writeback. */
+	bool referenced;            /* Read or written since the clock passed. */
+};
+
+/* Period of the writeback thread.  See page_cache.c. */
+extern unsigned writeback_ms;
+
 void page_cache_init (void);
-bool page_cache_initializer (struct page *page, enum vm_type type, void *kva);
+off_t page_cache_read (struct inode *, void *, off_t size, off_t offset);
+off_t page_cache_write (struct inode *, const void *, off_t size,
+		off_t offset);
+void page_cache_readahead (struct inode *, off_t start, off_t end);
+struct frame *page_cache_get (struct inode *, off_t index, bool may_evict);
+void page_cache_unpin (struct frame *);
+void page_cache_evict (struct frame *);
+void page_cache_flush (void);
+void page_cache_print_stats (void);
 #endif
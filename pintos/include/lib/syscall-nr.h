@@ -36,6 +36,9 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra for Project 3 */
+	SYS_MADVISE,                /* Give a hint about memory access. */
 };
 
 #endif /* lib/syscall-nr.h */
@@ -13,6 +13,17 @@ typedef int pid_t;
 typedef int off_t;
 #define MAP_FAILED ((void *) NULL)
 
+/* Or-ed into the WRITABLE argument of mmap() to fault the whole mapping
+ * in right away. */
+#define MAP_POPULATE 0x2
+
+/* Hints for madvise(). */
+#define MADV_NORMAL 0           /* No hint. */
+#define MADV_SEQUENTIAL 1       /* Will be read in order, once. */
+#define MADV_RANDOM 2           /* Will be read in no particular order. */
+#define MADV_WILLNEED 3         /* Will be used soon. */
+#define MADV_DONTNEED 4         /* Will not be used again. */
+
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
@@ -41,6 +52,7 @@ int dup2(int oldfd, int newfd);
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+int madvise (void *addr, size_t length, int advice);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -58,6 +70,28 @@ static inline void* get_phys_addr (void *user_addr) {
 	return pa;
 }
 
+/* Kinds of page faults for get_pf_stat(), as in userprog/exception.h. */
+#define PF_LAZY 0               /* First touch of a page. */
+#define PF_MINOR 1              /* Brought back without disk I/O. */
+#define PF_MAJOR 2              /* Read back from swap or its file. */
+#define PF_COW 3                /* Write to a merged page. */
+#define PF_HUGE 4               /* Served with a huge page. */
+#define PF_FIXUP 5              /* Bad pointer passed to a system call. */
+#define PF_BAD 6                /* Killed the process. */
+
+/* Queries for get_pf_stat(). */
+#define PF_Q_COUNT 0            /* Faults of all processes. */
+#define PF_Q_SELF 1             /* Faults of this process. */
+#define PF_Q_CYCLES 2           /* TSC cycles spent in all faults. */
+#define PF_Q_HIST 3             /* Plus a bucket: latency histogram. */
+
+static inline long long
+get_pf_stat (int kind, int query) {
+	long long value;
+	asm volatile ("int $0x45" : "=a" (value) : "a" (kind), "d" (query));
+	return value;
+}
+
 static inline long long
 get_fs_disk_read_cnt (void) {
 	long long read_cnt;
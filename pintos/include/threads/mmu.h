@@ -7,6 +7,19 @@
 
 typedef bool pte_for_each_func (uint64_t *pte, void *va, void *aux);
 
+/* Invalidations a batch collects before it flushes the whole TLB. */
+#define PML4_BATCH_MAX 32
+
+/* A run of page table updates to one pml4, see pml4_batch_begin(). */
+struct pml4_batch {
+	uint64_t *pml4;
+	bool active;                /* PML4 is loaded in CR3. */
+	uint64_t pt_base;           /* Address that PT starts to map. */
+	uint64_t *pt;               /* Last page table used, or NULL. */
+	size_t flush_cnt;           /* Pages to invalidate. */
+	uint64_t flush[PML4_BATCH_MAX];
+};
+
 uint64_t *pml4e_walk (uint64_t *pml4, const uint64_t va, int create);
 uint64_t *pml4_create (void);
 bool pml4_for_each (uint64_t *, pte_for_each_func *, void *);
@@ -19,6 +32,14 @@ bool pml4_is_dirty (uint64_t *pml4, const void *upage);
 void pml4_set_dirty (uint64_t *pml4, const void *upage, bool dirty);
 bool pml4_is_accessed (uint64_t *pml4, const void *upage);
 void pml4_set_accessed (uint64_t *pml4, const void *upage, bool accessed);
+uint64_t *pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage,
+		bool rw);
+void pml4_split_huge_page (uint64_t *pml4, void *upage, uint64_t *pt);
+void pml4_batch_begin (struct pml4_batch *b, uint64_t *pml4);
+bool pml4_batch_set_page (struct pml4_batch *b, void *upage, void *kpage,
+		bool rw);
+void pml4_batch_clear_page (struct pml4_batch *b, void *upage);
+void pml4_batch_end (struct pml4_batch *b);
 
 #define is_writable(pte) (*(pte) & PTE_W)
 #define is_user_pte(pte) (*(pte) & PTE_U)
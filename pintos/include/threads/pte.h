@@ -28,6 +28,11 @@
 #define PTX(la)  ((((uint64_t) (la)) >> PTXSHIFT) & 0x1FF)
 #define PTE_ADDR(pte) ((uint64_t) (pte) & ~0xFFF)
 
+/* A page directory entry with PTE_PS set maps one huge page of
+   HUGE_PGSIZE bytes, i.e. HUGE_PGCNT ordinary pages. */
+#define HUGE_PGSIZE (1UL << PDXSHIFT)
+#define HUGE_PGCNT (HUGE_PGSIZE / PGSIZE)
+
 /* The important flags are listed below.
    When a PDE or PTE is not "present", the other flags are
    ignored.
@@ -41,5 +46,6 @@
 #define PTE_U 0x4                        /* 1=user/kernel, 0=kernel only. */
 #define PTE_A 0x20                       /* 1=accessed, 0=not acccessed. */
 #define PTE_D 0x40                       /* 1=dirty, 0=not dirty (PTEs only). */
+#define PTE_PS 0x80                      /* 1=huge page (PDEs only). */
 
 #endif /* threads/pte.h */
@@ -9,6 +9,7 @@
 #include <stdint.h>
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "userprog/fault.h"
 #ifdef VM
 #include "vm/vm.h"
 #endif
@@ -133,6 +134,8 @@ struct thread {
 		struct list chd_list;
 		struct thread *par;
 		struct file *exe; /* 파일 실행 여부 확인 */
+		enum pf_kind pf_kind;              /* Page fault being handled. */
+		unsigned long long pf_cnt[PF_KIND_CNT];   /* Page faults by kind. */
 	#endif
 #ifdef VM
 	/* Table for whole virtual memory owned by thread. */
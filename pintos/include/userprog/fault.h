@@ -0,0 +1,34 @@
+#ifndef USERPROG_FAULT_H
+#define USERPROG_FAULT_H
+
+/* Page fault statistics.  Kept apart from userprog/exception.h so that
+   threads/thread.h can use them without the PF_* error code bits, which
+   clash with the ELF segment flags in userprog/process.c. */
+
+/* Kinds of page faults, for statistics. */
+enum pf_kind {
+	PF_LAZY,        /* First touch of a page. */
+	PF_MINOR,       /* Page brought back without disk I/O. */
+	PF_MAJOR,       /* Page read back from swap or from its file. */
+	PF_COW,         /* Write to a merged page, which got its own copy. */
+	PF_HUGE,        /* Served with a huge page. */
+	PF_FIXUP,       /* Bad user pointer in a copy routine, see uaccess.S. */
+	PF_BAD,         /* Killed the process. */
+	PF_KIND_CNT
+};
+
+/* Latency histogram buckets.  Bucket 0 counts faults that took fewer than
+   2**PF_HIST_SHIFT TSC cycles, each further bucket twice as long, and
+   the last one everything longer. */
+#define PF_HIST_SHIFT 10
+#define PF_HIST_CNT 16
+
+/* Queries of the page fault inspection interrupt, int 0x45.  RAX is the
+   kind and RDX the query; the answer comes back in RAX, -1 if the
+   query is bad. */
+#define PF_Q_COUNT 0                /* Faults of all processes. */
+#define PF_Q_SELF 1                 /* Faults of the current process. */
+#define PF_Q_CYCLES 2               /* TSC cycles spent in all faults. */
+#define PF_Q_HIST 3                 /* Plus a bucket: histogram entry. */
+
+#endif /* userprog/fault.h */
@@ -0,0 +1,63 @@
+#ifndef USERPROG_UACCESS_H
+#define USERPROG_UACCESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "threads/vaddr.h"
+
+/* Kernel access to user memory.
+
+   These copy straight from or to a user address without looking it up
+   first.  A page fault that the VM cannot resolve is caught through the
+   exception table (see page_fault()) and reported as a short copy, so a
+   bad pointer costs nothing until it is actually used.  Call them
+   without holding locks that the page fault handler may need. */
+
+size_t uaccess_copy (void *dst, const void *src, size_t n);
+long uaccess_strncpy (char *dst, const char *src, size_t n);
+
+/* Returns true if [UADDR, UADDR + N) lies entirely in user space. */
+static inline bool
+user_range_ok (const void *uaddr, size_t n) {
+	uintptr_t start = (uintptr_t) uaddr;
+	return start + n >= start && start + n <= KERN_BASE;
+}
+
+/* Copies N bytes from user address USRC to DST.  Returns the number of
+   bytes that could not be copied, 0 on success. */
+static inline size_t
+copy_from_user (void *dst, const void *usrc, size_t n) {
+	if (!user_range_ok (usrc, n))
+		return n;
+	return uaccess_copy (dst, usrc, n);
+}
+
+/* Copies N bytes from SRC to user address UDST.  Returns the number of
+   bytes that could not be copied, 0 on success. */
+static inline size_t
+copy_to_user (void *udst, const void *src, size_t n) {
+	if (!user_range_ok (udst, n))
+		return n;
+	return uaccess_copy (udst, src, n);
+}
+
+/* Copies the string at user address USRC, null terminator included, into
+   DST, which has room for N bytes.  Returns the length of the string, N
+   if it does not fit, or -1 if USRC is a bad pointer. */
+static inline long
+strncpy_from_user (char *dst, const char *usrc, size_t n) {
+	uintptr_t start = (uintptr_t) usrc;
+	size_t max;
+	long len;
+
+	if (start >= KERN_BASE)
+		return -1;
+	max = KERN_BASE - start < n ? KERN_BASE - start : n;
+	len = uaccess_strncpy (dst, usrc, max);
+	if (len >= 0 && (size_t) len == max && max < n)
+		return -1;      /* Ran into kernel space. */
+	return len;
+}
+
+#endif /* userprog/uaccess.h */
@@ -4,10 +4,27 @@
 struct page;
 enum vm_type;
 
+struct zswap_entry;
+
+/* Where the contents of an anonymous page are. */
+enum anon_where {
+	ANON_MEMORY,                /* In its frame. */
+	ANON_ZERO,                  /* All zero; nothing stored. */
+	ANON_ZSWAP,                 /* Compressed in the zswap pool. */
+	ANON_DISK,                  /* In a swap slot. */
+	ANON_FILE,                  /* Clean; reread from the VMA's file. */
+};
+
 struct anon_page {
+	enum anon_where where;
+	union {
+		struct zswap_entry *zswap;  /* ANON_ZSWAP: compressed copy. */
+		size_t slot;                /* ANON_DISK: swap slot. */
+	};
 };
 
 void vm_anon_init (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void vm_anon_print_stats (void);
 
 #endif
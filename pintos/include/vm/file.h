@@ -10,6 +10,10 @@ struct file_page {
 	bool writable;
 };
 
+/* Or-ed into the WRITABLE argument of mmap() to fault the whole mapping
+ * in right away.  Matches lib/user/syscall.h. */
+#define MAP_POPULATE 0x2
+
 void vm_file_init (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
 void *do_mmap(void *addr, size_t length, int writable,
@@ -0,0 +1,30 @@
+#ifndef VM_KSM_H
+#define VM_KSM_H
+#include <hash.h>
+#include <stdint.h>
+
+struct frame;
+
+/* Where a frame stands in same-page merging. */
+enum ksm_state {
+	KSM_NONE,                   /* Not in any table. */
+	KSM_UNSTABLE,               /* Private candidate seen in this pass. */
+	KSM_STABLE,                 /* Merged, read-only frame. */
+};
+
+/* Per-frame merging data, embedded in struct frame. */
+struct ksm_frame {
+	enum ksm_state state;
+	uint64_t checksum;          /* Contents hash from the last scan. */
+	struct hash_elem elem;      /* Element in the stable or unstable table. */
+};
+
+/* Scan rate.  See ksm.c. */
+extern unsigned ksm_pages_to_scan;
+extern unsigned ksm_sleep_ms;
+
+void ksm_init (void);
+void ksm_forget (struct frame *frame);
+void ksm_print_stats (void);
+
+#endif /* vm/ksm.h */
@@ -1,8 +1,8 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <list.h>
 #include "threads/palloc.h"
-#include "lib/kernel/hash.h"
 
 enum vm_type {
 	/* page not initialized */
@@ -26,14 +26,15 @@ enum vm_type {
 };
 
 #include "vm/uninit.h"
+#include "vm/vma.h"
+#include "vm/ksm.h"
 #include "vm/anon.h"
 #include "vm/file.h"
-#ifdef EFILESYS
 #include "filesys/page_cache.h"
-#endif
 
 struct page_operations;
 struct thread;
+struct pml4_batch;
 
 #define VM_TYPE(type) ((type) & 7)
 
@@ -47,8 +48,12 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* project3 spt */
-	struct hash_elem he;
 	bool writable;         /* True if writable, false if read-only */
+	struct vma *vma;       /* Area this page was faulted in from, or NULL */
+	bool dirty;            /* Contents differ from the backing file */
+	bool referenced;       /* Accessed bit taken by the WSS sampler */
+	struct thread *owner;  /* Process whose pml4 maps this page */
+	struct list_elem frame_elem;  /* Element in frame->pages */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -62,12 +67,29 @@ struct page {
 	};
 };
 
-/* The representation of "frame" */
+/* The representation of "frame".
+ * A frame is normally mapped by exactly one page.  Read-only text frames
+ * and merged anonymous frames are shared: every page on PAGES maps the
+ * frame read-only, and the frame is freed when the last of them goes
+ * away.  A frame of the page cache is kept while no page maps it, and
+ * every mmap of that file page maps it writable.  All frames in use are
+ * on frame_table. */
 struct frame {
 	void *kva;
-	struct page *page;
+	struct list pages;          /* Pages mapping this frame. */
+	struct list_elem elem;      /* Element in frame_table. */
+	bool pinned;                /* Being filled by the kernel; hands off. */
+	bool evicting;              /* Pages being written out; see vm_evict(). */
+	struct text_entry *text;    /* Entry in the text cache, or NULL. */
+	struct ksm_frame ksm;       /* Same-page merging state. */
+	struct huge_frame *huge;    /* Huge page this frame is part of, or NULL. */
+	struct pcache_page *pc;     /* Page cache entry, or NULL. */
 };
 
+/* Frames in use, and the lock that protects them and their page lists. */
+extern struct list frame_table;
+extern struct lock frame_lock;
+
 /* The function table for page operations.
  * This is one way of implementing "interface" in C.
  * Put the table of "method" into the struct's member, and
@@ -85,23 +107,56 @@ struct page_operations {
 	if ((page)->operations->destroy) (page)->operations->destroy (page)
 
 /* Representation of current process's memory space.
- * We don't want to force you to obey any specific design for this struct.
- * All designs up to you for this. */
+ * The SPT is a 4-level radix tree keyed by user virtual address that
+ * mirrors the layout of the pml4: the top three levels hold pointers to
+ * the next level, and the slots of the last level hold `struct page *'.
+ * Nodes are allocated lazily on insert and are only released when the
+ * whole table is killed, the same way page tables are. */
 struct supplemental_page_table {
-	struct hash pages;
+	struct spt_node *root;      /* Level-4 node, NULL while empty. */
+	struct vma_tree vmas;       /* Mapped areas not backed by pages yet. */
+	struct pml4_batch *batch;   /* Open batch of the owner, or NULL. */
+
+	/* Memory accounting.  Protected by frame_lock. */
+	size_t rss;                 /* Pages mapped to a frame now. */
+	size_t rss_peak;            /* Largest RSS so far. */
+	size_t self_evicted;        /* Own pages evicted while over the cap. */
+	size_t wss;                 /* Working set estimate, in pages. */
+	size_t wss_cur;             /* Pages seen accessed in pass WSS_GEN. */
+	unsigned wss_gen;           /* Sampling pass WSS_CUR belongs to. */
+	void *reclaim_cursor;       /* Where the next own eviction looks. */
+	size_t huge_cnt;            /* Huge pages mapped now. */
+	size_t huge_peak;           /* Most huge pages mapped at once. */
+	size_t huge_splits;         /* Huge pages split into small pages. */
 };
 
+/* Callback for spt_for_each().  Returning false stops the walk. */
+typedef bool spt_for_each_func (struct page *page, void *aux);
+
 #include "threads/thread.h"
 void supplemental_page_table_init (struct supplemental_page_table *spt);
 bool supplemental_page_table_copy (struct supplemental_page_table *dst,
 		struct supplemental_page_table *src);
 void supplemental_page_table_kill (struct supplemental_page_table *spt);
+void spt_batch_begin (struct supplemental_page_table *spt,
+		struct pml4_batch *b);
+void spt_batch_end (struct supplemental_page_table *spt);
 struct page *spt_find_page (struct supplemental_page_table *spt,
 		void *va);
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
+bool spt_for_each (struct supplemental_page_table *spt, void *start,
+		void *end, spt_for_each_func *func, void *aux);
+
+/* Tunables.  See vm.c. */
+extern size_t fault_around_pages;
+extern size_t kswapd_low, kswapd_high;
+extern bool thp_enabled;
+extern size_t rss_limit;
+extern unsigned wss_sample_ms;
 
 void vm_init (void);
+void vm_print_stats (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
@@ -110,23 +165,17 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
+void vm_release_frame (struct page *page);
+struct frame *vm_alloc_frame (bool may_evict);
+void vm_free_unused_frame (struct frame *frame);
+void vm_frame_move (struct page *page, struct frame *frame);
+void vm_page_sync_dirty (struct page *page);
+void vm_evict_wait (void);
+void vm_page_wait (struct page *page);
+void vm_mm_report (struct supplemental_page_table *spt);
 bool vm_claim_page (void *va);
+void vm_populate (void *start, void *end, bool may_evict);
+int do_madvise (void *addr, size_t length, int advice);
 enum vm_type page_get_type (struct page *page);
 
-
-static uint64_t
-spt_hash_func (const struct hash_elem *hash_e, void *aux);
-
-static bool
-spt_less_func (const struct hash_elem *a, const struct hash_elem *b, void *aux);
-
-
-struct file_load_aux
-{
-	struct file *file;
-	off_t offset;
-	size_t read_bytes;
-	size_t zero_bytes;
-};
-
 #endif  /* VM_VM_H */
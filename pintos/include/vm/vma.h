@@ -0,0 +1,69 @@
+#ifndef VM_VMA_H
+#define VM_VMA_H
+#include <stdbool.h>
+#include <stddef.h>
+#include "filesys/off_t.h"
+#include "vm/vm.h"
+
+struct file;
+
+/* Access pattern hints given with madvise().  The values are part of the
+ * system call interface and match MADV_* in lib/user/syscall.h.  The
+ * first three are kept in a VMA; the other two act once on the pages. */
+enum madv {
+	MADV_NORMAL,                /* No hint. */
+	MADV_SEQUENTIAL,            /* Read ahead further, evict early. */
+	MADV_RANDOM,                /* No fault-around. */
+	MADV_WILLNEED,              /* Fault the range in now. */
+	MADV_DONTNEED,              /* Drop the range. */
+};
+
+/* A virtual memory area: a page-aligned range of user addresses whose
+ * pages share the same backing and permissions.  Pages inside a VMA get
+ * their `struct page' only when they are first faulted in, so mapping a
+ * region costs O(1) no matter how large it is. */
+struct vma {
+	void *start;                /* First address, page-aligned. */
+	void *end;                  /* One past the last address, page-aligned. */
+	struct file *file;          /* Backing file owned by the VMA, or NULL. */
+	off_t offset;               /* Offset of START within FILE. */
+	size_t read_bytes;          /* Bytes read from FILE; the rest is zeroed. */
+	bool writable;              /* True if the pages are writable. */
+	enum vm_type type;          /* Type the pages become on first fault. */
+	vm_initializer *init;       /* Fills a page on its first fault. */
+	enum madv advice;           /* MADV_NORMAL, _SEQUENTIAL or _RANDOM. */
+
+	/* Interval tree links.  Owned by vma.c. */
+	struct vma *left, *right;
+	void *max_end;              /* Largest END in this subtree. */
+	int height;                 /* AVL height of this subtree. */
+};
+
+/* Interval tree of the VMAs of one address space.  VMAs never overlap,
+ * so they are ordered by START and each node is augmented with the
+ * largest END below it to answer overlap queries in O(log n). */
+struct vma_tree {
+	struct vma *root;
+};
+
+/* Callback for vma_for_each().  Returning false stops the walk. */
+typedef bool vma_for_each_func (struct vma *vma, void *aux);
+
+void vma_tree_init (struct vma_tree *tree);
+struct vma *vma_create (void *start, void *end, struct file *file,
+		off_t offset, size_t read_bytes, bool writable, enum vm_type type,
+		vm_initializer *init);
+bool vma_insert (struct vma_tree *tree, struct vma *vma);
+void vma_remove (struct vma_tree *tree, struct vma *vma);
+void vma_destroy (struct vma *vma);
+struct vma *vma_find (struct vma_tree *tree, const void *va);
+struct vma *vma_find_overlap (struct vma_tree *tree, const void *start,
+		const void *end);
+size_t vma_page_read_bytes (const struct vma *vma, const void *upage);
+bool vma_read_page (const struct vma *vma, const void *upage, void *kva);
+bool vma_for_each (struct vma_tree *tree, vma_for_each_func *func,
+		void *aux);
+bool vma_tree_copy (struct vma_tree *dst, struct vma_tree *src);
+void vma_tree_kill (struct vma_tree *tree);
+
+#endif /* vm/vma.h */
@@ -0,0 +1,21 @@
+#ifndef VM_ZSWAP_H
+#define VM_ZSWAP_H
+#include <stdbool.h>
+#include <stddef.h>
+
+struct zswap_entry;
+
+/* Called when the compressed copy of OWNER's page ages out of the pool,
+ * with DATA holding the decompressed page.  Returns false if the page
+ * could not be written anywhere else, in which case it stays. */
+typedef bool zswap_writeback_func (void *owner, const void *data);
+
+/* Upper bound on pool size, in pages.  See zswap.c. */
+extern size_t zswap_max_pages;
+
+void zswap_init (zswap_writeback_func *writeback);
+struct zswap_entry *zswap_store (const void *page, void *owner);
+void zswap_load (struct zswap_entry *entry, void *page);
+void zswap_free (struct zswap_entry *entry);
+
+#endif /* vm/zswap.h */
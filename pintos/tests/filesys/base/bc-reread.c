@@ -0,0 +1,36 @@
+/* Writes a small file, reads it once, and checks that reading it again
+   is served from the cache without any disk reads. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[4096];
+static char copy[4096];
+
+void
+test_main (void) 
+{
+  const char *file_name = "reread";
+  long long reads;
+  int fd, i;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"%s\"", file_name);
+  seek (fd, 0);
+  CHECK (read (fd, copy, sizeof copy) == sizeof copy, "read \"%s\"", file_name);
+
+  reads = get_fs_disk_read_cnt ();
+  for (i = 0; i < 3; i++)
+    {
+      seek (fd, 0);
+      if (read (fd, copy, sizeof copy) != sizeof copy)
+        fail ("reread of \"%s\" came up short", file_name);
+      compare_bytes (copy, buf, sizeof buf, 0, file_name);
+    }
+  CHECK (get_fs_disk_read_cnt () == reads, "rereads did not touch the disk");
+  close (fd);
+}
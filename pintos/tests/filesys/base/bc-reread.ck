@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bc-reread) begin
+(bc-reread) create "reread"
+(bc-reread) open "reread"
+(bc-reread) write "reread"
+(bc-reread) read "reread"
+(bc-reread) rereads did not touch the disk
+(bc-reread) end
+EOF
+pass;
@@ -0,0 +1,26 @@
+/* Opens a file that does not exist, so that the directory lookup cache
+   remembers the miss, then creates and removes the file and checks that
+   each open sees the change. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const char *file_name = "late";
+  int fd;
+
+  CHECK (open (file_name) == -1, "open \"%s\" before create", file_name);
+  CHECK (open (file_name) == -1, "open \"%s\" again", file_name);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\" after create", file_name);
+  close (fd);
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+  CHECK (open (file_name) == -1, "open \"%s\" after remove", file_name);
+  CHECK (create (file_name, 0), "create \"%s\" again", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\" after second create",
+         file_name);
+  close (fd);
+}
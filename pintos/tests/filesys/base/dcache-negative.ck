@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dcache-negative) begin
+(dcache-negative) open "late" before create
+(dcache-negative) open "late" again
+(dcache-negative) create "late"
+(dcache-negative) open "late" after create
+(dcache-negative) remove "late"
+(dcache-negative) open "late" after remove
+(dcache-negative) create "late" again
+(dcache-negative) open "late" after second create
+(dcache-negative) end
+EOF
+pass;
@@ -0,0 +1,56 @@
+/* Creates enough files in the root directory that its hash table has
+   to be rebuilt at least twice, then checks that every file can still
+   be found, and that removed names are gone while the rest stay. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 120
+
+static void
+make_name (char name[16], int i)
+{
+  snprintf (name, 16, "rehash%d", i);
+}
+
+void
+test_main (void) 
+{
+  char name[16];
+  int i, fd;
+
+  quiet = true;
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      make_name (name, i);
+      CHECK (create (name, 0), "create \"%s\"", name);
+    }
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      make_name (name, i);
+      CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+      close (fd);
+    }
+  for (i = 0; i < FILE_CNT; i += 2)
+    {
+      make_name (name, i);
+      CHECK (remove (name), "remove \"%s\"", name);
+    }
+  quiet = false;
+  msg ("created %d files", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      make_name (name, i);
+      fd = open (name);
+      if (i % 2 == 0 && fd != -1)
+        fail ("removed file \"%s\" still opens", name);
+      if (i % 2 == 1 && fd < 2)
+        fail ("file \"%s\" lost", name);
+      if (fd > 1)
+        close (fd);
+    }
+  msg ("every other file removed");
+}
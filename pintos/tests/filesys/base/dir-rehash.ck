@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-rehash) begin
+(dir-rehash) created 120 files
+(dir-rehash) every other file removed
+(dir-rehash) end
+EOF
+pass;
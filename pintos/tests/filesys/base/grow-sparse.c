@@ -0,0 +1,47 @@
+/* Grows an empty file by writing well past its end, far enough that
+   the inode index has to go beyond its direct sectors, and checks that
+   the gap reads back as zeros and the written data is intact. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define GAP (512 * 200 + 123)
+#define TAIL 1500
+
+static char tail[TAIL];
+static char block[512];
+
+void
+test_main (void) 
+{
+  size_t ofs;
+  int fd;
+
+  random_bytes (tail, sizeof tail);
+  CHECK (create ("sparse", 0), "create \"sparse\"");
+  CHECK ((fd = open ("sparse")) > 1, "open \"sparse\"");
+
+  seek (fd, GAP);
+  CHECK (write (fd, tail, sizeof tail) == sizeof tail, "write past end");
+  CHECK (filesize (fd) == GAP + TAIL, "file grew to %d bytes", GAP + TAIL);
+
+  seek (fd, 0);
+  for (ofs = 0; ofs < GAP; ofs += sizeof block)
+    {
+      size_t size = GAP - ofs < sizeof block ? GAP - ofs : sizeof block;
+      size_t i;
+
+      if (read (fd, block, size) != (int) size)
+        fail ("read %zu bytes at offset %zu failed", size, ofs);
+      for (i = 0; i < size; i++)
+        if (block[i] != 0)
+          fail ("byte %zu of the gap is %d, not 0", ofs + i, block[i]);
+    }
+  msg ("gap reads as zeros");
+
+  CHECK (read (fd, block, sizeof block) == sizeof block, "read tail");
+  compare_bytes (block, tail, sizeof block, GAP, "sparse");
+  close (fd);
+}
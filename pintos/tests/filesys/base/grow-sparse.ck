@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-sparse) begin
+(grow-sparse) create "sparse"
+(grow-sparse) open "sparse"
+(grow-sparse) write past end
+(grow-sparse) file grew to 104023 bytes
+(grow-sparse) gap reads as zeros
+(grow-sparse) read tail
+(grow-sparse) end
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Writes a file larger than the buffer cache, then reads it back
+   sequentially in odd-sized chunks, skipping ahead and back with seek,
+   so that readahead runs ahead of the reads and is cut off by the
+   seeks.  Every chunk must match what was written. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 49152
+#define CHUNK 1237
+
+static char buf[FILE_SIZE];
+static char copy[CHUNK];
+
+/* Reads from OFS to END of FD in CHUNK-byte pieces and checks them. */
+static void
+read_range (int fd, size_t ofs, size_t end) 
+{
+  seek (fd, ofs);
+  while (ofs < end)
+    {
+      size_t size = end - ofs < CHUNK ? end - ofs : CHUNK;
+      if (read (fd, copy, size) != (int) size)
+        fail ("read %zu bytes at offset %zu failed", size, ofs);
+      compare_bytes (copy, buf + ofs, size, ofs, "readahead");
+      ofs += size;
+    }
+}
+
+void
+test_main (void) 
+{
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("readahead", sizeof buf), "create \"readahead\"");
+  CHECK ((fd = open ("readahead")) > 1, "open \"readahead\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"readahead\"");
+
+  msg ("read whole file");
+  read_range (fd, 0, FILE_SIZE);
+  msg ("read second half, then first half");
+  read_range (fd, FILE_SIZE / 2 + 333, FILE_SIZE);
+  read_range (fd, 777, FILE_SIZE / 2 + 333);
+  msg ("read past end of file");
+  seek (fd, FILE_SIZE - 100);
+  CHECK (read (fd, copy, CHUNK) == 100, "short read at end of file");
+  close (fd);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(lg-readahead) begin
+(lg-readahead) create "readahead"
+(lg-readahead) open "readahead"
+(lg-readahead) write "readahead"
+(lg-readahead) read whole file
+(lg-readahead) read second half, then first half
+(lg-readahead) read past end of file
+(lg-readahead) short read at end of file
+(lg-readahead) end
+EOF
+pass;
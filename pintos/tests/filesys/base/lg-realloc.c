@@ -0,0 +1,81 @@
+/* Fills three files, removes the middle one and creates a larger file
+   in its place, several times over, so that the allocator has to
+   reuse freed clusters and wrap around past the used ones.  Every
+   file must still read back what was written to it. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SMALL 20480
+#define LARGE 40960
+#define ROUNDS 4
+
+static char a[SMALL], c[SMALL], big[LARGE];
+static char copy[LARGE];
+
+/* Creates NAME with the SIZE bytes at BUF. */
+static void
+put (const char *name, const char *buf, size_t size) 
+{
+  int fd;
+
+  if (!create (name, 0))
+    fail ("create \"%s\" failed", name);
+  if ((fd = open (name)) < 2)
+    fail ("open \"%s\" failed", name);
+  if (write (fd, buf, size) != (int) size)
+    fail ("write \"%s\" failed", name);
+  close (fd);
+}
+
+/* Checks that NAME holds the SIZE bytes at BUF. */
+static void
+verify (const char *name, const char *buf, size_t size) 
+{
+  int fd;
+
+  if ((fd = open (name)) < 2)
+    fail ("open \"%s\" failed", name);
+  if (filesize (fd) != (int) size)
+    fail ("\"%s\" is %d bytes, not %zu", name, filesize (fd), size);
+  if (read (fd, copy, size) != (int) size)
+    fail ("read \"%s\" failed", name);
+  compare_bytes (copy, buf, size, 0, name);
+  close (fd);
+}
+
+void
+test_main (void) 
+{
+  char name[16];
+  int i;
+
+  random_bytes (a, sizeof a);
+  random_bytes (c, sizeof c);
+  random_bytes (big, sizeof big);
+
+  put ("a", a, sizeof a);
+  put ("b", big, SMALL);
+  put ("c", c, sizeof c);
+  msg ("created \"a\", \"b\", \"c\"");
+
+  for (i = 0; i < ROUNDS; i++)
+    {
+      const char *old = i == 0 ? "b" : name;
+      char new[16];
+
+      snprintf (new, sizeof new, "big%d", i);
+      if (!remove (old))
+        fail ("remove \"%s\" failed", old);
+      big[i] ^= 0xff;
+      put (new, big, sizeof big);
+      verify ("a", a, sizeof a);
+      verify ("c", c, sizeof c);
+      verify (new, big, sizeof big);
+      snprintf (name, sizeof name, "%s", new);
+    }
+  msg ("replaced the middle file %d times", ROUNDS);
+}
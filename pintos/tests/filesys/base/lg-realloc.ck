@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(lg-realloc) begin
+(lg-realloc) created "a", "b", "c"
+(lg-realloc) replaced the middle file 4 times
+(lg-realloc) end
+EOF
+pass;
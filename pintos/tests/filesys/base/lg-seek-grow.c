@@ -0,0 +1,61 @@
+/* Reads a file in random order through one descriptor, grows it
+   through another, then reads the grown file in random order through
+   the first one again.  Positions remembered from the first pass must
+   not send the reads of the second pass to the wrong place. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 512
+#define FIRST_CNT 100
+#define BLOCK_CNT 150
+
+static char buf[BLOCK_SIZE * BLOCK_CNT];
+static int order[BLOCK_CNT];
+
+/* Reads the first CNT blocks of FD in random order and checks them. */
+static void
+read_random (int fd, size_t cnt) 
+{
+  char block[BLOCK_SIZE];
+  size_t i;
+
+  for (i = 0; i < cnt; i++)
+    order[i] = i;
+  shuffle (order, cnt, sizeof *order);
+  for (i = 0; i < cnt; i++)
+    {
+      size_t ofs = BLOCK_SIZE * order[i];
+      seek (fd, ofs);
+      if (read (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("read %d bytes at offset %zu failed", BLOCK_SIZE, ofs);
+      compare_bytes (block, buf + ofs, BLOCK_SIZE, ofs, "seek-grow");
+    }
+}
+
+void
+test_main (void) 
+{
+  size_t first = BLOCK_SIZE * FIRST_CNT;
+  int reader, writer;
+
+  random_init (46);
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("seek-grow", 0), "create \"seek-grow\"");
+  CHECK ((reader = open ("seek-grow")) > 1, "open reader");
+  CHECK ((writer = open ("seek-grow")) > 1, "open writer");
+  CHECK (write (writer, buf, first) == (int) first, "write first part");
+
+  msg ("read first part in random order");
+  read_random (reader, FIRST_CNT);
+
+  CHECK (write (writer, buf + first, sizeof buf - first)
+         == (int) (sizeof buf - first), "grow through writer");
+
+  msg ("read grown file in random order");
+  read_random (reader, BLOCK_CNT);
+  close (writer);
+  close (reader);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(lg-seek-grow) begin
+(lg-seek-grow) create "seek-grow"
+(lg-seek-grow) open reader
+(lg-seek-grow) open writer
+(lg-seek-grow) write first part
+(lg-seek-grow) read first part in random order
+(lg-seek-grow) grow through writer
+(lg-seek-grow) read grown file in random order
+(lg-seek-grow) end
+EOF
+pass;
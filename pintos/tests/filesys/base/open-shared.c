@@ -0,0 +1,65 @@
+/* Opens one file twice and checks that both descriptors share its
+   inode: a write through one is seen through the other, and the data
+   outlives removing the file while it is open.  Then keeps many
+   distinct files open at once and checks that each still names its
+   own file. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 40
+
+static const char data[] = "shared through one inode";
+
+void
+test_main (void) 
+{
+  int fds[FILE_CNT];
+  char name[16], buf[32];
+  int fd1, fd2, i;
+
+  CHECK (create ("shared", 0), "create \"shared\"");
+  CHECK ((fd1 = open ("shared")) > 1, "open \"shared\"");
+  CHECK ((fd2 = open ("shared")) > 1, "open \"shared\" again");
+  CHECK (fd1 != fd2, "two different descriptors");
+
+  CHECK (write (fd1, data, sizeof data) == sizeof data,
+         "write through first descriptor");
+  CHECK (filesize (fd2) == sizeof data, "second descriptor sees new size");
+  CHECK (read (fd2, buf, sizeof data) == sizeof data,
+         "read through second descriptor");
+  CHECK (!memcmp (buf, data, sizeof data), "data matches");
+
+  CHECK (remove ("shared"), "remove \"shared\"");
+  seek (fd2, 0);
+  CHECK (read (fd2, buf, sizeof data) == sizeof data
+         && !memcmp (buf, data, sizeof data), "data survives remove");
+  close (fd1);
+  close (fd2);
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+      if ((fds[i] = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      if (write (fds[i], name, strlen (name) + 1) != (int) strlen (name) + 1)
+        fail ("write \"%s\" failed", name);
+    }
+  msg ("opened %d files", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      seek (fds[i], 0);
+      if (read (fds[i], buf, strlen (name) + 1) != (int) strlen (name) + 1
+          || strcmp (buf, name))
+        fail ("\"%s\" does not hold its own name", name);
+      close (fds[i]);
+    }
+  msg ("every file holds its own name");
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(open-shared) begin
+(open-shared) create "shared"
+(open-shared) open "shared"
+(open-shared) open "shared" again
+(open-shared) two different descriptors
+(open-shared) write through first descriptor
+(open-shared) second descriptor sees new size
+(open-shared) read through second descriptor
+(open-shared) data matches
+(open-shared) remove "shared"
+(open-shared) data survives remove
+(open-shared) opened 40 files
+(open-shared) every file holds its own name
+(open-shared) end
+EOF
+pass;
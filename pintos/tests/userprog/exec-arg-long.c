@@ -0,0 +1,15 @@
+/* Passes a command line longer than a file name may be to exec.
+   All of its arguments must reach the child. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  msg ("I'm your father");
+  exec ("child-args arg00 arg01 arg02 arg03 arg04 arg05 arg06 arg07 "
+        "arg08 arg09 arg10 arg11 arg12 arg13 arg14 arg15 arg16 arg17 "
+        "arg18 arg19 arg20 arg21 arg22 arg23 arg24 arg25 arg26 arg27");
+}
@@ -0,0 +1,43 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(exec-arg-long) begin
+(exec-arg-long) I'm your father
+(args) begin
+(args) argc = 29
+(args) argv[0] = 'child-args'
+(args) argv[1] = 'arg00'
+(args) argv[2] = 'arg01'
+(args) argv[3] = 'arg02'
+(args) argv[4] = 'arg03'
+(args) argv[5] = 'arg04'
+(args) argv[6] = 'arg05'
+(args) argv[7] = 'arg06'
+(args) argv[8] = 'arg07'
+(args) argv[9] = 'arg08'
+(args) argv[10] = 'arg09'
+(args) argv[11] = 'arg10'
+(args) argv[12] = 'arg11'
+(args) argv[13] = 'arg12'
+(args) argv[14] = 'arg13'
+(args) argv[15] = 'arg14'
+(args) argv[16] = 'arg15'
+(args) argv[17] = 'arg16'
+(args) argv[18] = 'arg17'
+(args) argv[19] = 'arg18'
+(args) argv[20] = 'arg19'
+(args) argv[21] = 'arg20'
+(args) argv[22] = 'arg21'
+(args) argv[23] = 'arg22'
+(args) argv[24] = 'arg23'
+(args) argv[25] = 'arg24'
+(args) argv[26] = 'arg25'
+(args) argv[27] = 'arg26'
+(args) argv[28] = 'arg27'
+(args) argv[29] = null
+(args) end
+exec-arg-long: exit(0)
+EOF
+pass;
@@ -0,0 +1,18 @@
+/* Passes an invalid pointer to the read system call at end of file,
+   where there is nothing to copy.  The process must still be
+   terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int handle;
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  seek (handle, filesize (handle));
+  read (handle, (char *) 0xc0100000, 123);
+  fail ("should not have survived read()");
+}
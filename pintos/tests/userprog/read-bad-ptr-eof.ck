@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(read-bad-ptr-eof) begin
+(read-bad-ptr-eof) open "sample.txt"
+read-bad-ptr-eof: exit(-1)
+EOF
+pass;
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(write-bad-ptr-zero) begin
+(write-bad-ptr-zero) open "sample.txt"
+write-bad-ptr-zero: exit(-1)
+EOF
+pass;
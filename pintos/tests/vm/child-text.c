@@ -0,0 +1,38 @@
+/* Child process of text-share.
+   Run without arguments, runs itself again with the frame number of
+   its own code page as the argument, keeping that page mapped, and
+   exits with the status of that run.  Run with a frame number, exits
+   with 0 if its code page is in the same frame, 1 otherwise. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+
+/* Frame number of the code page holding this function. */
+static int
+text_frame (void)
+{
+  return ((uintptr_t) get_phys_addr ((void *) text_frame) >> 12) & 0x7fffffff;
+}
+
+int
+main (int argc, char *argv[])
+{
+  char cmd[32];
+  pid_t pid;
+
+  test_name = "child-text";
+  if (argc > 1)
+    return atoi (argv[1]) == text_frame () ? 0 : 1;
+
+  snprintf (cmd, sizeof cmd, "child-text %d", text_frame ());
+  pid = fork ("child-text");
+  if (pid == 0)
+    {
+      exec (cmd);
+      fail ("exec \"%s\" failed", cmd);
+    }
+  return wait (pid);
+}
@@ -0,0 +1,44 @@
+/* Touches one page in the middle of a large initialized array, which
+   is loaded lazily from the executable, and checks that the other
+   pages of its 16-page fault-around window came in with it while the
+   next window of the array did not. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define WINDOW 16
+#define DATA_PAGES (4 * WINDOW)
+
+static char data[DATA_PAGES * PAGE_SIZE] = {1};
+
+static bool
+loaded (uintptr_t page)
+{
+  return get_phys_addr ((void *) (page * PAGE_SIZE)) != 0;
+}
+
+void
+test_main (void)
+{
+  uintptr_t first = ((uintptr_t) data + PAGE_SIZE - 1) / PAGE_SIZE;
+  uintptr_t touched = first + DATA_PAGES / 2;
+  uintptr_t lo = touched - touched % WINDOW;
+  uintptr_t page;
+
+  CHECK (!loaded (touched), "page is not loaded before it is touched");
+  if (*(volatile char *) (touched * PAGE_SIZE) != 0)
+    fail ("initialized data reads back wrong");
+
+  for (page = lo; page < lo + WINDOW; page++)
+    if (!loaded (page))
+      fail ("page %d of the window is not mapped", (int) (page - lo));
+  msg ("pages in the window around the fault are mapped");
+
+  for (page = lo + WINDOW; page < lo + 2 * WINDOW; page++)
+    if (loaded (page))
+      fail ("page %d past the window is mapped", (int) (page - lo));
+  msg ("pages past the window are not mapped");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fault-around-data) begin
+(fault-around-data) page is not loaded before it is touched
+(fault-around-data) pages in the window around the fault are mapped
+(fault-around-data) pages past the window are not mapped
+(fault-around-data) end
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Fills two anonymous pages with the same bytes and reads a large file,
+   which keeps the CPU idle long enough for the merging thread to run,
+   until both pages map the same frame.  Then writes to one of them and
+   checks that it gets its own copy back and the other keeps its data. */
+
+#include <stdint.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char buf[3 * PAGE_SIZE];
+static char scratch[PAGE_SIZE];
+
+static bool
+all_bytes (const char *p, char c, size_t n)
+{
+  size_t i;
+
+  for (i = 0; i < n; i++)
+    if (p[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  char *a = (char *) (((uintptr_t) buf + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1));
+  char *b = a + PAGE_SIZE;
+  int handle;
+  bool merged = false;
+
+  memset (a, 'k', PAGE_SIZE);
+  memset (b, 'k', PAGE_SIZE);
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  while (!merged && read (handle, scratch, sizeof scratch) > 0)
+    merged = get_phys_addr (a) == get_phys_addr (b);
+  close (handle);
+  CHECK (merged, "identical pages are merged");
+
+  a[0] = 'x';
+  CHECK (get_phys_addr (a) != get_phys_addr (b),
+         "a write gives the writer its own copy");
+  CHECK (a[1] == 'k' && all_bytes (b, 'k', PAGE_SIZE),
+         "both pages keep their data");
+}
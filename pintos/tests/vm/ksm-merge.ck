@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ksm-merge) begin
+(ksm-merge) open "large.txt"
+(ksm-merge) identical pages are merged
+(ksm-merge) a write gives the writer its own copy
+(ksm-merge) both pages keep their data
+(ksm-merge) end
+EOF
+pass;
@@ -0,0 +1,46 @@
+/* Maps a file and checks that the mapping and the read and write
+   system calls see the same data while the file is still mapped:
+   a write() shows up in the mapping, and a store through the mapping
+   shows up in read(), without munmap in between. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((char *) 0x10000000)
+
+static const char via_write[] = "written with write()";
+static const char via_map[] = "stored through the mapping";
+
+void
+test_main (void)
+{
+  int handle;
+  void *map;
+  char buf[64];
+
+  CHECK (create ("coherent", 8192), "create \"coherent\"");
+  CHECK ((handle = open ("coherent")) > 1, "open \"coherent\"");
+  CHECK ((map = mmap (ACTUAL, 8192, 1, handle, 0)) != MAP_FAILED,
+         "mmap \"coherent\"");
+
+  /* Fault in both pages before writing, so that write() has to reach
+     pages that are already mapped. */
+  CHECK (ACTUAL[0] == 0 && ACTUAL[4096] == 0, "mapping starts zeroed");
+
+  seek (handle, 100);
+  CHECK (write (handle, via_write, sizeof via_write) == sizeof via_write,
+         "write to file");
+  CHECK (!memcmp (ACTUAL + 100, via_write, sizeof via_write),
+         "mapping sees write()");
+
+  memcpy (ACTUAL + 5000, via_map, sizeof via_map);
+  seek (handle, 5000);
+  CHECK (read (handle, buf, sizeof via_map) == sizeof via_map,
+         "read from file");
+  CHECK (!memcmp (buf, via_map, sizeof via_map), "read() sees the mapping");
+
+  munmap (map);
+  close (handle);
+}
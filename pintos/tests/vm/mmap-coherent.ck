@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-coherent) begin
+(mmap-coherent) create "coherent"
+(mmap-coherent) open "coherent"
+(mmap-coherent) mmap "coherent"
+(mmap-coherent) mapping starts zeroed
+(mmap-coherent) write to file
+(mmap-coherent) mapping sees write()
+(mmap-coherent) read from file
+(mmap-coherent) read() sees the mapping
+(mmap-coherent) end
+EOF
+pass;
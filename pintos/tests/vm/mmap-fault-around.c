@@ -0,0 +1,56 @@
+/* Maps the same file three times and touches the first page of each
+   mapping.  Without a hint, and with MADV_RANDOM, a mapped file stays
+   demand-paged and only the page touched is mapped; MADV_SEQUENTIAL
+   maps twice the 16-page fault-around window ahead. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/large.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define MAP_PAGES 64
+
+static bool
+loaded (char *map, int page)
+{
+  return get_phys_addr (map + page * PAGE_SIZE) != 0;
+}
+
+static char *
+map_file (char *addr, int handle, int advice, const char *name)
+{
+  CHECK (mmap (addr, MAP_PAGES * PAGE_SIZE, 0, handle, 0) != MAP_FAILED,
+         "mmap \"large.txt\" %s", name);
+  CHECK (madvise (addr, MAP_PAGES * PAGE_SIZE, advice) == 0,
+         "madvise %s", name);
+  if (addr[0] != large[0])
+    fail ("read of mmap'd file reported bad data");
+  return addr;
+}
+
+void
+test_main (void)
+{
+  char *normal = (char *) 0x10000000;
+  char *random = (char *) 0x20000000;
+  char *seq = (char *) 0x30000000;
+  int handle;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+
+  map_file (normal, handle, MADV_NORMAL, "normal");
+  CHECK (!loaded (normal, 1), "normal mapping maps only the page touched");
+
+  map_file (random, handle, MADV_RANDOM, "random");
+  CHECK (!loaded (random, 1), "random mapping maps only the page touched");
+
+  map_file (seq, handle, MADV_SEQUENTIAL, "sequential");
+  CHECK (loaded (seq, 31), "sequential mapping maps two windows ahead");
+  CHECK (!loaded (seq, 32), "but no further");
+
+  if (memcmp (seq + 31 * PAGE_SIZE, large + 31 * PAGE_SIZE, PAGE_SIZE))
+    fail ("pages mapped around a fault hold bad data");
+  close (handle);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-fault-around) begin
+(mmap-fault-around) open "large.txt"
+(mmap-fault-around) mmap "large.txt" normal
+(mmap-fault-around) madvise normal
+(mmap-fault-around) normal mapping maps only the page touched
+(mmap-fault-around) mmap "large.txt" random
+(mmap-fault-around) madvise random
+(mmap-fault-around) random mapping maps only the page touched
+(mmap-fault-around) mmap "large.txt" sequential
+(mmap-fault-around) madvise sequential
+(mmap-fault-around) sequential mapping maps two windows ahead
+(mmap-fault-around) but no further
+(mmap-fault-around) end
+EOF
+pass;
@@ -0,0 +1,37 @@
+/* Maps a file with MAP_POPULATE, gives it each madvise() hint and checks
+   that the data survives, including a write dropped with MADV_DONTNEED. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle;
+  void *map;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (actual, 4096, 1 | MAP_POPULATE, handle, 0))
+         != MAP_FAILED, "mmap \"sample.txt\" with MAP_POPULATE");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of populated mapping reported bad data");
+
+  CHECK (madvise (actual, 4096, MADV_SEQUENTIAL) == 0, "madvise sequential");
+  CHECK (madvise (actual, 4096, MADV_RANDOM) == 0, "madvise random");
+  CHECK (madvise (actual + 1, 4096, MADV_NORMAL) == -1,
+         "madvise misaligned (must return -1)");
+  CHECK (madvise (actual, 4096, 99) == -1, "madvise bad hint (must return -1)");
+
+  actual[0] = '#';
+  CHECK (madvise (actual, 4096, MADV_DONTNEED) == 0, "madvise dontneed");
+  if (actual[0] != '#' || memcmp (actual + 1, sample + 1, strlen (sample) - 1))
+    fail ("mapping lost data across MADV_DONTNEED");
+
+  CHECK (madvise (actual, 4096, MADV_WILLNEED) == 0, "madvise willneed");
+  munmap (map);
+  close (handle);
+}
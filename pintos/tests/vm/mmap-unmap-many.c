@@ -0,0 +1,36 @@
+/* Maps 64 pages of a file all at once, unmaps them, and checks that
+   every page is gone from the page table and that touching the last one
+   kills the process, so no stale translation survived the unmap. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define MAP_PAGES 64
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  int handle, i;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK (mmap (actual, MAP_PAGES * PAGE_SIZE, MAP_POPULATE, handle, 0)
+         != MAP_FAILED, "mmap \"large.txt\" with MAP_POPULATE");
+  for (i = 0; i < MAP_PAGES; i++)
+    if (get_phys_addr (actual + i * PAGE_SIZE) == 0)
+      fail ("page %d was not populated", i);
+  if (memcmp (actual, "Lorem ipsum", 11))
+    fail ("read of mmap'd file reported bad data");
+
+  munmap (actual);
+  for (i = 0; i < MAP_PAGES; i++)
+    if (get_phys_addr (actual + i * PAGE_SIZE) != 0)
+      fail ("page %d still mapped after munmap", i);
+  msg ("all pages unmapped");
+
+  fail ("unmapped memory is readable (%d)",
+        actual[(MAP_PAGES - 1) * PAGE_SIZE]);
+}
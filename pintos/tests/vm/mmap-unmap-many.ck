@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(mmap-unmap-many) begin
+(mmap-unmap-many) open "large.txt"
+(mmap-unmap-many) mmap "large.txt" with MAP_POPULATE
+(mmap-unmap-many) all pages unmapped
+mmap-unmap-many: exit(-1)
+EOF
+pass;
@@ -0,0 +1,32 @@
+/* Writes to a shared file mapping and, without unmapping or closing it,
+   waits for the writeback thread to put the dirty page on disk. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SPIN_MAX 5000000
+
+void
+test_main (void)
+{
+  char *actual = (char *) 0x10000000;
+  long long writes;
+  int handle, spins;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (mmap (actual, 4096, 1, handle, 0) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  if (memcmp (actual, sample, strlen (sample)))
+    fail ("read of mmap'd file reported bad data");
+
+  writes = get_fs_disk_write_cnt ();
+  actual[0] = '#';
+  for (spins = 0; spins < SPIN_MAX; spins++)
+    if (get_fs_disk_write_cnt () != writes)
+      break;
+  CHECK (spins < SPIN_MAX, "dirty page written back while still mapped");
+  close (handle);
+}
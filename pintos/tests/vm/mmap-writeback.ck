@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-writeback) begin
+(mmap-writeback) open "sample.txt"
+(mmap-writeback) mmap "sample.txt"
+(mmap-writeback) dirty page written back while still mapped
+(mmap-writeback) end
+EOF
+pass;
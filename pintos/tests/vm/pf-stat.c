@@ -0,0 +1,57 @@
+/* Touches untouched pages of BSS and checks that get_pf_stat() counts
+   the lazy faults, for this process and overall, and that the latency
+   histogram adds up to the count. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 8
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+
+static long long
+hist_sum (int kind)
+{
+  long long sum = 0;
+  int b;
+
+  for (b = 0; b < 16; b++)
+    sum += get_pf_stat (kind, PF_Q_HIST + b);
+  return sum;
+}
+
+void
+test_main (void)
+{
+  long long self, all, before, after, sum;
+  size_t i;
+
+  self = get_pf_stat (PF_LAZY, PF_Q_SELF);
+  all = get_pf_stat (PF_LAZY, PF_Q_COUNT);
+  CHECK (self >= 0 && all >= self, "read lazy fault counts");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    buf[i * PAGE_SIZE] = i;
+  CHECK (get_pf_stat (PF_LAZY, PF_Q_SELF) > self,
+         "touching BSS counts a lazy fault for this process");
+  CHECK (get_pf_stat (PF_LAZY, PF_Q_COUNT) > all,
+         "touching BSS counts a lazy fault overall");
+  CHECK (get_pf_stat (PF_LAZY, PF_Q_CYCLES) > 0, "lazy faults took cycles");
+
+  before = get_pf_stat (PF_LAZY, PF_Q_COUNT);
+  sum = hist_sum (PF_LAZY);
+  after = get_pf_stat (PF_LAZY, PF_Q_COUNT);
+  CHECK (before <= sum && sum <= after, "histogram adds up to the count");
+
+  CHECK (get_pf_stat (PF_BAD + 1, PF_Q_COUNT) == -1,
+         "bad kind (must return -1)");
+  CHECK (get_pf_stat (PF_LAZY, PF_Q_HIST + 16) == -1,
+         "bad query (must return -1)");
+
+  for (i = 0; i < PAGE_CNT; i++)
+    if (buf[i * PAGE_SIZE] != (char) i)
+      fail ("page %zu lost its contents", i);
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(pf-stat) begin
+(pf-stat) read lazy fault counts
+(pf-stat) touching BSS counts a lazy fault for this process
+(pf-stat) touching BSS counts a lazy fault overall
+(pf-stat) lazy faults took cycles
+(pf-stat) histogram adds up to the count
+(pf-stat) bad kind (must return -1)
+(pf-stat) bad query (must return -1)
+(pf-stat) end
+EOF
+pass;
@@ -0,0 +1,41 @@
+/* Writes 256 pages of BSS in a process capped at 64 resident pages, and
+   checks that no more than the cap stay mapped, that the process evicts
+   its own pages to stay under it, and that every page keeps its data. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_COUNT 256
+#define RSS_CAP 64
+
+static char buf[PAGE_COUNT * PAGE_SIZE];
+
+static size_t
+resident (void)
+{
+  size_t i, n = 0;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    if (get_phys_addr (buf + i * PAGE_SIZE) != 0)
+      n++;
+  return n;
+}
+
+void
+test_main (void)
+{
+  size_t i;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    buf[i * PAGE_SIZE] = (char) (i + 1);
+  CHECK (resident () <= RSS_CAP, "no more than %d pages resident", RSS_CAP);
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    if (buf[i * PAGE_SIZE] != (char) (i + 1))
+      fail ("page %zu lost its data", i);
+  msg ("every page kept its data");
+  CHECK (resident () <= RSS_CAP, "still no more than %d pages resident",
+         RSS_CAP);
+}
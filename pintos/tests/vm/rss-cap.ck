@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(rss-cap) begin
+(rss-cap) no more than 64 pages resident
+(rss-cap) every page kept its data
+(rss-cap) still no more than 64 pages resident
+(rss-cap) end
+EOF
+pass;
@@ -0,0 +1,52 @@
+/* Reads 2 MB of read-only data from the executable twice while 2 MB of
+   anonymous memory competes for the frames, with a swap disk of only
+   1 MB.  The read-only pages are clean, so they have to be dropped and
+   read back from the executable rather than written to swap, or swap
+   runs out. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define DATA_SIZE (2 * 1024 * 1024)
+#define DATA_PAGES (DATA_SIZE / PAGE_SIZE)
+#define ANON_SIZE (2 * 1024 * 1024)
+
+static const char data[DATA_SIZE] = {'L', 'o', 'r', 'e', 'm'};
+static char anon[ANON_SIZE];
+static unsigned sums[DATA_PAGES];
+
+static unsigned
+page_sum (const char *p)
+{
+  unsigned sum = 0;
+  size_t i;
+
+  for (i = 0; i < PAGE_SIZE; i++)
+    sum = sum * 31 + (unsigned char) p[i];
+  return sum;
+}
+
+void
+test_main (void)
+{
+  size_t i;
+
+  if (data[0] != 'L' || data[4] != 'm')
+    fail ("read-only data reads back wrong");
+
+  for (i = 0; i < DATA_PAGES; i++)
+    sums[i] = page_sum (data + i * PAGE_SIZE);
+  for (i = 0; i < ANON_SIZE; i += PAGE_SIZE)
+    anon[i] = (char) (i / PAGE_SIZE + 1);
+  msg ("read the data and wrote anonymous memory");
+
+  for (i = 0; i < DATA_PAGES; i++)
+    if (page_sum (data + i * PAGE_SIZE) != sums[i])
+      fail ("page %zu of the data changed", i);
+  for (i = 0; i < ANON_SIZE; i += PAGE_SIZE)
+    if (anon[i] != (char) (i / PAGE_SIZE + 1))
+      fail ("anonymous page %zu lost its data", i / PAGE_SIZE);
+  msg ("read both back");
+}
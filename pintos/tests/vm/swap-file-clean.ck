@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-file-clean) begin
+(swap-file-clean) read the data and wrote anonymous memory
+(swap-file-clean) read both back
+(swap-file-clean) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Runs two processes that each write and then check more anonymous
+   memory than half of RAM, with watermarks high enough that kswapd does
+   most of the reclaim while both of them keep faulting. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (6 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+#define CHILD_CNT 2
+
+static char big_chunks[CHUNK_SIZE];
+
+static int
+touch (int seed)
+{
+  size_t i, j;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    for (j = 0; j < PAGE_SIZE; j += 512)
+      big_chunks[i * PAGE_SIZE + j] = (char) (i + j + seed);
+  for (i = 0; i < PAGE_COUNT; i++)
+    for (j = 0; j < PAGE_SIZE; j += 512)
+      if (big_chunks[i * PAGE_SIZE + j] != (char) (i + j + seed))
+        return 1;
+  return 0;
+}
+
+void
+test_main (void) 
+{
+  pid_t children[CHILD_CNT];
+  int i;
+
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      children[i] = fork ("child");
+      if (children[i] == 0)
+        exit (touch (i));
+    }
+  for (i = 0; i < CHILD_CNT; i++)
+    CHECK (wait (children[i]) == 0, "child %d kept its data", i);
+}
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-kswapd) begin
+(swap-kswapd) child 0 kept its data
+(swap-kswapd) child 1 kept its data
+(swap-kswapd) end
+EOF
+pass;
@@ -0,0 +1,36 @@
+/* Writes one byte into each page of more anonymous memory than fits in
+   RAM, so that mostly empty pages get compressed on their way out, then
+   reads every page back.  Some of them must come back from compressed
+   swap, which counts as a minor fault, and all of them intact. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (12 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+
+static char big_chunks[CHUNK_SIZE];
+
+void
+test_main (void) 
+{
+  long long minor;
+  size_t i;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    big_chunks[i * PAGE_SIZE] = (char) (i + 1);
+  msg ("wrote %d pages", PAGE_COUNT);
+
+  minor = get_pf_stat (PF_MINOR, PF_Q_SELF);
+  for (i = 0; i < PAGE_COUNT; i++)
+    if (big_chunks[i * PAGE_SIZE] != (char) (i + 1)
+        || big_chunks[i * PAGE_SIZE + 1] != 0)
+      fail ("data is inconsistent in page %zu", i);
+  msg ("read back %d pages", PAGE_COUNT);
+  CHECK (get_pf_stat (PF_MINOR, PF_Q_SELF) > minor,
+         "some pages came back from compressed swap");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-zswap) begin
+(swap-zswap) wrote 3072 pages
+(swap-zswap) read back 3072 pages
+(swap-zswap) some pages came back from compressed swap
+(swap-zswap) end
+EOF
+pass;
@@ -0,0 +1,20 @@
+/* Runs a program that runs itself again while it is still running, and
+   checks that the second run maps the code pages of the first instead
+   of reading them in again. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  pid_t pid = fork ("child-text");
+
+  if (pid == 0)
+    {
+      exec ("child-text");
+      fail ("exec \"child-text\" failed");
+    }
+  CHECK (wait (pid) == 0, "second run shares the code frame of the first");
+}
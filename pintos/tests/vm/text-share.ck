@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(text-share) begin
+(text-share) second run shares the code frame of the first
+(text-share) end
+EOF
+pass;
@@ -0,0 +1,45 @@
+/* Touches one byte of an aligned 2 MiB window of BSS and checks that the
+   whole window got mapped at once, to physically contiguous memory, and
+   that it reads as zeros and keeps what is written to it. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HUGE_SIZE (2 * 1024 * 1024)
+#define HUGE_PAGES (HUGE_SIZE / PAGE_SIZE)
+
+static char buf[2 * HUGE_SIZE];
+
+void
+test_main (void)
+{
+  char *base = (char *) (((uintptr_t) buf + HUGE_SIZE - 1)
+                         & ~(uintptr_t) (HUGE_SIZE - 1));
+  long long huge = get_pf_stat (PF_HUGE, PF_Q_SELF);
+  char *pa;
+  size_t i;
+
+  base[0] = 1;
+  CHECK (get_pf_stat (PF_HUGE, PF_Q_SELF) == huge + 1,
+         "one fault served with a huge page");
+
+  pa = get_phys_addr (base);
+  for (i = 1; i < HUGE_PAGES; i++)
+    if ((char *) get_phys_addr (base + i * PAGE_SIZE) != pa + i * PAGE_SIZE)
+      fail ("page %zu of the window is not contiguous", i);
+  msg ("whole window mapped contiguously");
+
+  for (i = 1; i < HUGE_PAGES; i++)
+    {
+      if (base[i * PAGE_SIZE] != 0)
+        fail ("page %zu of the window is not zeroed", i);
+      base[i * PAGE_SIZE] = (char) i;
+    }
+  for (i = 1; i < HUGE_PAGES; i++)
+    if (base[i * PAGE_SIZE] != (char) i)
+      fail ("page %zu of the window lost its data", i);
+  msg ("window keeps its data");
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(thp-bss) begin
+(thp-bss) one fault served with a huge page
+(thp-bss) whole window mapped contiguously
+(thp-bss) window keeps its data
+(thp-bss) end
+EOF
+pass;
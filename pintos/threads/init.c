@@ -31,9 +31,12 @@
 #include "tests/threads/tests.h"
 #ifdef VM
 #include "vm/vm.h"
+#include "vm/zswap.h"
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
+#include "filesys/buffer_cache.h"
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
 #endif
@@ -226,6 +229,28 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-fa"))
+			fault_around_pages = atoi (value);
+		else if (!strcmp (name, "-ksm-scan"))
+			ksm_pages_to_scan = atoi (value);
+		else if (!strcmp (name, "-ksm-sleep"))
+			ksm_sleep_ms = atoi (value);
+		else if (!strcmp (name, "-zswap"))
+			zswap_max_pages = atoi (value);
+		else if (!strcmp (name, "-wmark-low"))
+			kswapd_low = atoi (value);
+		else if (!strcmp (name, "-wmark-high"))
+			kswapd_high = atoi (value);
+		else if (!strcmp (name, "-wb"))
+			writeback_ms = atoi (value);
+		else if (!strcmp (name, "-thp"))
+			thp_enabled = atoi (value) != 0;
+		else if (!strcmp (name, "-rss"))
+			rss_limit = atoi (value);
+		else if (!strcmp (name, "-wss-ms"))
+			wss_sample_ms = atoi (value);
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -328,6 +353,19 @@ usage (void) {
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -fa=PAGES          Map up to PAGES pages around a file fault.\n"
+			"  -ksm-scan=N        Scan N frames per KSM wakeup (0 disables).\n"
+			"  -ksm-sleep=MS      Sleep MS milliseconds between KSM wakeups.\n"
+			"  -zswap=PAGES       Keep up to PAGES pages of compressed swap.\n"
+			"  -wmark-low=PAGES   Wake kswapd below PAGES free user pages.\n"
+			"  -wmark-high=PAGES  Let kswapd sleep at PAGES free user pages.\n"
+			"  -wb=MS             Write back dirty cached pages every MS ms (0 disables).\n"
+			"  -thp=0|1           Turn huge pages for zero-filled ELF segments\n"
+			"                     (BSS) off or on.\n"
+			"  -rss=PAGES         Cap every process at PAGES resident pages.\n"
+			"  -wss-ms=MS         Sample working sets every MS ms (0 disables).\n"
 #endif
 			);
 	power_off ();
@@ -356,10 +394,18 @@ print_stats (void) {
 	thread_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
+	buffer_cache_print_stats ();
+	dcache_print_stats ();
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+	page_cache_print_stats ();
+	ksm_print_stats ();
+	vm_anon_print_stats ();
+#endif
 }
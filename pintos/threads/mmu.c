@@ -8,11 +8,17 @@
 #include "threads/mmu.h"
 #include "intrinsic.h"
 
+/* A huge page has no page table entry of its own, so the walk returns
+ * its page directory entry instead, whose flags are laid out the same. */
 static uint64_t *
 pgdir_walk (uint64_t *pdp, const uint64_t va, int create) {
 	int idx = PDX (va);
 	if (pdp) {
 		uint64_t *pte = (uint64_t *) pdp[idx];
+		if ((pdp[idx] & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS)) {
+			ASSERT (!create);
+			return &pdp[idx];
+		}
 		if (!((uint64_t) pte & PTE_P)) {
 			if (create) {
 				uint64_t *new_page = palloc_get_page (PAL_ZERO);
@@ -117,12 +123,13 @@ pt_for_each (uint64_t *pt, pte_for_each_func *func, void *aux,
 	return true;
 }
 
+/* Huge pages are skipped: they have no page table to walk. */
 static bool
 pgdir_for_each (uint64_t *pdp, pte_for_each_func *func, void *aux,
 		unsigned pml4_index, unsigned pdp_index) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if ((((uint64_t) pte) & PTE_P) && !(pdp[i] & PTE_PS))
 			if (!pt_for_each ((uint64_t *) PTE_ADDR (pte), func, aux,
 					pml4_index, pdp_index, i))
 				return false;
@@ -165,11 +172,12 @@ pt_destroy (uint64_t *pt) {
 	palloc_free_page ((void *) pt);
 }
 
+/* Huge pages belong to the VM, which frees them itself. */
 static void
 pgdir_destroy (uint64_t *pdp) {
 	for (unsigned i = 0; i < PGSIZE / sizeof(uint64_t *); i++) {
 		uint64_t *pte = ptov((uint64_t *) pdp[i]);
-		if (((uint64_t) pte) & PTE_P)
+		if ((((uint64_t) pte) & PTE_P) && !(pdp[i] & PTE_PS))
 			pt_destroy (PTE_ADDR (pte));
 	}
 	palloc_free_page ((void *) pdp);
@@ -216,14 +224,18 @@ pml4_get_page (uint64_t *pml4, const void *uaddr) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) uaddr, 0);
 
-	if (pte && (*pte & PTE_P))
+	if (pte && (*pte & PTE_P)) {
+		if (*pte & PTE_PS)
+			return ptov (PTE_ADDR (*pte))
+				+ ((uint64_t) uaddr & (HUGE_PGSIZE - 1));
 		return ptov (PTE_ADDR (*pte)) + pg_ofs (uaddr);
+	}
 	return NULL;
 }
 
 /* Adds a mapping in page map level 4 PML4 from user virtual page
  * UPAGE to the physical frame identified by kernel virtual address KPAGE.
- * UPAGE must not already be mapped. KPAGE should probably be a page obtained
+ * An existing mapping of UPAGE is replaced. KPAGE should probably be a page obtained
  * from the user pool with palloc_get_page().
  * If WRITABLE is true, the new page is read/write;
  * otherwise it is read-only.
@@ -238,8 +250,13 @@ pml4_set_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
 
 	uint64_t *pte = pml4e_walk (pml4, (uint64_t) upage, 1);
 
-	if (pte)
+	if (pte) {
+		/* Replacing a live mapping: drop the stale TLB entry. */
+		bool flush = (*pte & PTE_P) != 0 && rcr3 () == vtop (pml4);
 		*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+		if (flush)
+			invlpg ((uint64_t) upage);
+	}
 	return pte != NULL;
 }
 
@@ -281,7 +298,7 @@ pml4_set_dirty (uint64_t *pml4, const void *vpage, bool dirty) {
 		if (dirty)
 			*pte |= PTE_D;
 		else
-			*pte &= ~(uint32_t) PTE_D;
+			*pte &= ~(uint64_t) PTE_D;
 
 		if (rcr3 () == vtop (pml4))
 			invlpg ((uint64_t) vpage);
@@ -307,9 +324,180 @@ pml4_set_accessed (uint64_t *pml4, const void *vpage, bool accessed) {
 		if (accessed)
 			*pte |= PTE_A;
 		else
-			*pte &= ~(uint32_t) PTE_A;
+			*pte &= ~(uint64_t) PTE_A;
 
 		if (rcr3 () == vtop (pml4))
 			invlpg ((uint64_t) vpage);
 	}
 }
+
+/* Returns the page directory entry for VA in PML4, creating the page
+ * directory pointer table and page directory on the way if CREATE.
+ * Returns NULL if one is missing, or could not be allocated. */
+static uint64_t *
+pde_walk (uint64_t *pml4, const uint64_t va, bool create) {
+	uint64_t *table = pml4;
+
+	for (int level = 0; level < 2; level++) {
+		uint64_t *e = &table[level == 0 ? PML4 (va) : PDPE (va)];
+		if (!(*e & PTE_P)) {
+			uint64_t *new_page;
+			if (!create || (new_page = palloc_get_page (PAL_ZERO)) == NULL)
+				return NULL;
+			*e = vtop (new_page) | PTE_U | PTE_W | PTE_P;
+		}
+		table = ptov (PTE_ADDR (*e));
+	}
+	return &table[PDX (va)];
+}
+
+/* Maps the HUGE_PGSIZE bytes of user virtual memory at UPAGE to the
+ * physically contiguous frames at KPAGE with a single page directory
+ * entry.  Both must be aligned on HUGE_PGSIZE, and no page of UPAGE may
+ * be mapped.  Returns the page table that pml4_split_huge_page() will
+ * need, which the caller keeps until then: the one that covered UPAGE
+ * before, or a fresh one.  Returns a null pointer if memory allocation
+ * failed. */
+uint64_t *
+pml4_set_huge_page (uint64_t *pml4, void *upage, void *kpage, bool rw) {
+	ASSERT (((uint64_t) upage & (HUGE_PGSIZE - 1)) == 0);
+	ASSERT ((vtop (kpage) & (HUGE_PGSIZE - 1)) == 0);
+	ASSERT (is_user_vaddr (upage));
+	ASSERT (pml4 != base_pml4);
+
+	uint64_t *pde = pde_walk (pml4, (uint64_t) upage, true);
+	uint64_t *pt;
+
+	if (pde == NULL)
+		return NULL;
+	if (*pde & PTE_P) {
+		ASSERT (!(*pde & PTE_PS));
+		pt = ptov (PTE_ADDR (*pde));
+	} else if ((pt = palloc_get_page (0)) == NULL)
+		return NULL;
+
+	*pde = vtop (kpage) | PTE_PS | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	/* The old page table may still be cached for UPAGE. */
+	if (rcr3 () == vtop (pml4))
+		invlpg ((uint64_t) upage);
+	return pt;
+}
+
+/* Turns the huge page at UPAGE in PML4 back into HUGE_PGCNT ordinary
+ * pages mapping the same frames, using the page table PT that
+ * pml4_set_huge_page() returned.  Every new entry inherits the flags of
+ * the huge one, including its accessed and dirty bits. */
+void
+pml4_split_huge_page (uint64_t *pml4, void *upage, uint64_t *pt) {
+	uint64_t *pde = pde_walk (pml4, (uint64_t) upage, false);
+
+	ASSERT (pde != NULL && (*pde & PTE_PS));
+
+	uint64_t flags = *pde & (PTE_P | PTE_W | PTE_U | PTE_A | PTE_D);
+	uint64_t pa = PTE_ADDR (*pde);
+	for (size_t i = 0; i < HUGE_PGCNT; i++)
+		pt[i] = (pa + i * PGSIZE) | flags;
+	*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+	if (rcr3 () == vtop (pml4))
+		invlpg ((uint64_t) upage);
+}
+
+/* Starts a batch of updates to PML4.  pml4_batch_set_page() and
+ * pml4_batch_clear_page() work like pml4_set_page() and
+ * pml4_clear_page(), but reuse the page table of the previous call when
+ * it covers the next page too, and only note which TLB entries went
+ * stale.  pml4_batch_end() invalidates them all at once, so nothing may
+ * access the pages through PML4 until then.  Other updates to PML4 may
+ * go on meanwhile as long as they do not free page tables. */
+void
+pml4_batch_begin (struct pml4_batch *b, uint64_t *pml4) {
+	ASSERT (pml4 != base_pml4);
+
+	b->pml4 = pml4;
+	b->active = rcr3 () == vtop (pml4);
+	b->pt = NULL;
+	b->flush_cnt = 0;
+}
+
+/* Returns the page table entry for VA in the pml4 of B, creating page
+ * tables on the way if CREATE, like pml4e_walk(). */
+static uint64_t *
+batch_walk (struct pml4_batch *b, uint64_t va, bool create) {
+	uint64_t base = va & ~(uint64_t) (HUGE_PGSIZE - 1);
+
+	if (b->pt == NULL || b->pt_base != base) {
+		uint64_t *pde = pde_walk (b->pml4, va, create);
+
+		b->pt = NULL;
+		if (pde == NULL)
+			return NULL;
+		if (*pde & PTE_PS)
+			return pde;
+		if (!(*pde & PTE_P)) {
+			uint64_t *pt;
+			if (!create || (pt = palloc_get_page (PAL_ZERO)) == NULL)
+				return NULL;
+			*pde = vtop (pt) | PTE_U | PTE_W | PTE_P;
+		}
+		b->pt = ptov (PTE_ADDR (*pde));
+		b->pt_base = base;
+	}
+	return &b->pt[PTX (va)];
+}
+
+/* Notes that the TLB entry for VA went stale. */
+static void
+batch_invalidate (struct pml4_batch *b, uint64_t va) {
+	if (!b->active)
+		return;
+	if (b->flush_cnt < PML4_BATCH_MAX)
+		b->flush[b->flush_cnt] = va;
+	b->flush_cnt++;
+}
+
+/* pml4_set_page() as part of batch B. */
+bool
+pml4_batch_set_page (struct pml4_batch *b, void *upage, void *kpage,
+		bool rw) {
+	ASSERT (pg_ofs (upage) == 0);
+	ASSERT (pg_ofs (kpage) == 0);
+	ASSERT (is_user_vaddr (upage));
+
+	uint64_t *pte = batch_walk (b, (uint64_t) upage, true);
+
+	if (pte == NULL)
+		return false;
+	ASSERT (!(*pte & PTE_PS));
+	if (*pte & PTE_P)
+		batch_invalidate (b, (uint64_t) upage);
+	*pte = vtop (kpage) | PTE_P | (rw ? PTE_W : 0) | PTE_U;
+	return true;
+}
+
+/* pml4_clear_page() as part of batch B. */
+void
+pml4_batch_clear_page (struct pml4_batch *b, void *upage) {
+	ASSERT (pg_ofs (upage) == 0);
+	ASSERT (is_user_vaddr (upage));
+
+	uint64_t *pte = batch_walk (b, (uint64_t) upage, false);
+
+	if (pte != NULL && (*pte & PTE_P) != 0) {
+		ASSERT (!(*pte & PTE_PS));
+		*pte &= ~PTE_P;
+		batch_invalidate (b, (uint64_t) upage);
+	}
+}
+
+/* Ends batch B, invalidating every TLB entry it made stale, or the whole
+ * TLB if there were more than PML4_BATCH_MAX. */
+void
+pml4_batch_end (struct pml4_batch *b) {
+	if (b->flush_cnt > PML4_BATCH_MAX)
+		lcr3 (rcr3 ());
+	else
+		for (size_t i = 0; i < b->flush_cnt; i++)
+			invlpg (b->flush[i]);
+	b->flush_cnt = 0;
+	b->pt = NULL;
+}
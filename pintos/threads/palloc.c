@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/loader.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -31,6 +32,8 @@ struct pool {
 	struct lock lock;               /* Mutual exclusion. */
 	struct bitmap *used_map;        /* Bitmap of free pages. */
 	uint8_t *base;                  /* Base of pool. */
+	size_t free_cnt;                /* Number of free pages. */
+	size_t page_cnt;                /* Number of usable pages. */
 };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -42,6 +45,7 @@ static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end);
 
 static bool page_from_pool (const struct pool *, void *page);
+static void count_free (struct pool *, size_t delta);
 
 /* multiboot info */
 struct multiboot_info {
@@ -224,11 +228,15 @@ split:
 			if ((uint64_t) pool_end < end) {
 				page_cnt = ((uint64_t) pool_end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool->free_cnt += page_cnt;
+				pool->page_cnt += page_cnt;
 				start = (uint64_t) pool_end;
 				goto split;
 			} else {
 				page_cnt = ((uint64_t) end - start) / PGSIZE;
 				bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+				pool->free_cnt += page_cnt;
+				pool->page_cnt += page_cnt;
 			}
 		}
 	}
@@ -265,6 +273,8 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 
 	lock_acquire (&pool->lock);
 	size_t page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
+	if (page_idx != BITMAP_ERROR)
+		count_free (pool, -page_cnt);
 	lock_release (&pool->lock);
 	void *pages;
 
@@ -284,6 +294,40 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt) {
 	return pages;
 }
 
+/* Like palloc_get_multiple(), but the PAGE_CNT pages start at a
+   multiple of ALIGN_CNT pages, both in kernel virtual and in physical
+   memory, which differ only by KERN_BASE.  ALIGN_CNT must be a power of
+   two.  The pages may later be freed one at a time. */
+void *
+palloc_get_aligned (enum palloc_flags flags, size_t page_cnt,
+		size_t align_cnt) {
+	struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+	size_t bit_cnt = bitmap_size (pool->used_map);
+	size_t page_idx = BITMAP_ERROR;
+	void *pages = NULL;
+
+	ASSERT (align_cnt > 0 && (align_cnt & (align_cnt - 1)) == 0);
+
+	lock_acquire (&pool->lock);
+	for (size_t i = (align_cnt - pg_no (pool->base) % align_cnt) % align_cnt;
+			i + page_cnt <= bit_cnt; i += align_cnt)
+		if (bitmap_none (pool->used_map, i, page_cnt)) {
+			bitmap_set_multiple (pool->used_map, i, page_cnt, true);
+			count_free (pool, -page_cnt);
+			page_idx = i;
+			break;
+		}
+	lock_release (&pool->lock);
+
+	if (page_idx != BITMAP_ERROR) {
+		pages = pool->base + PGSIZE * page_idx;
+		if (flags & PAL_ZERO)
+			memset (pages, 0, PGSIZE * page_cnt);
+	} else if (flags & PAL_ASSERT)
+		PANIC ("palloc_get: out of pages");
+	return pages;
+}
+
 /* Obtains a single free page and returns its kernel virtual
    address.
    If PAL_USER is set, the page is obtained from the user pool,
@@ -320,6 +364,7 @@ palloc_free_multiple (void *pages, size_t page_cnt) {
 #endif
 	ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
 	bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+	count_free (pool, page_cnt);
 }
 
 /* Frees the page at PAGE. */
@@ -328,6 +373,28 @@ palloc_free_page (void *page) {
 	palloc_free_multiple (page, 1);
 }
 
+/* Returns the number of free pages in the user pool. */
+size_t
+palloc_user_free_pages (void) {
+	return user_pool.free_cnt;
+}
+
+/* Returns the number of pages in the user pool. */
+size_t
+palloc_user_pages (void) {
+	return user_pool.page_cnt;
+}
+
+/* Adds DELTA to the free page count of POOL.  Pages are freed without
+   the pool lock held, so the update is made atomic by turning
+   interrupts off instead. */
+static void
+count_free (struct pool *pool, size_t delta) {
+	enum intr_level old_level = intr_disable ();
+	pool->free_cnt += delta;
+	intr_set_level (old_level);
+}
+
 /* Initializes pool P as starting at START and ending at END */
 static void
 init_pool (struct pool *p, void **bm_base, uint64_t start, uint64_t end) {
@@ -9,8 +9,33 @@
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+/* Page faults of every kind, including the ones the VM resolved. */
+static long long pf_total_cnt;
+
+/* Page faults by kind, the TSC cycles spent in them from entry to return,
+   and their latency histograms. */
+static unsigned long long pf_cnt[PF_KIND_CNT];
+static unsigned long long pf_cycles[PF_KIND_CNT];
+static unsigned long long pf_hist[PF_KIND_CNT][PF_HIST_CNT];
+
+static const char *pf_kind_names[PF_KIND_CNT] = {
+	"lazy", "minor", "major", "cow", "huge", "fixup", "bad",
+};
+
+/* An exception table entry: a kernel instruction that accesses user
+   memory, and the code to resume at if it faults.  The entries are
+   collected by the linker between __ex_table_start and __ex_table_end. */
+struct ex_entry {
+	uintptr_t insn;
+	uintptr_t fixup;
+};
+extern const struct ex_entry __ex_table_start[], __ex_table_end[];
+
+static uintptr_t search_fixup (uintptr_t rip);
+
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
+static void inspect_faults (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
    programs.
@@ -58,12 +83,71 @@ exception_init (void) {
 	   We need to disable interrupts for page faults because the
 	   fault address is stored in CR2 and needs to be preserved. */
 	intr_register_int (14, 0, INTR_OFF, page_fault, "#PF Page-Fault Exception");
+
+	/* Page fault statistics for user programs; see exception.h. */
+	intr_register_int (0x45, 3, INTR_OFF, inspect_faults,
+			"Inspect Page Faults");
 }
 
 /* Prints exception statistics. */
 void
 exception_print_stats (void) {
 	printf ("Exception: %lld page faults\n", page_fault_cnt);
+	printf ("  %lld faults in all\n", pf_total_cnt);
+	for (int k = 0; k < PF_KIND_CNT; k++) {
+		if (pf_cnt[k] == 0)
+			continue;
+		printf ("  %-5s %8llu faults, %8llu cycles avg, histogram:",
+				pf_kind_names[k], pf_cnt[k], pf_cycles[k] / pf_cnt[k]);
+		for (int b = 0; b < PF_HIST_CNT; b++)
+			printf (" %llu", pf_hist[k][b]);
+		printf ("\n");
+	}
+}
+
+/* Counts a page fault of KIND that came in at TSC time START. */
+static void
+count_fault (enum pf_kind kind, uint64_t start) {
+	uint64_t cycles = rdtsc () - start;
+	uint64_t c = cycles >> PF_HIST_SHIFT;
+	int b = 0;
+
+	while (c != 0 && b < PF_HIST_CNT - 1) {
+		c >>= 1;
+		b++;
+	}
+
+	enum intr_level old_level = intr_disable ();
+	pf_total_cnt++;
+	pf_cnt[kind]++;
+	pf_cycles[kind] += cycles;
+	pf_hist[kind][b]++;
+	thread_current ()->pf_cnt[kind]++;
+	intr_set_level (old_level);
+}
+
+/* Answers a page fault statistics query, int 0x45.
+   Input:
+     @RAX - Kind of fault, enum pf_kind
+     @RDX - Query, PF_Q_*
+   Output:
+     @RAX - The count asked for, or -1 for a bad query. */
+static void
+inspect_faults (struct intr_frame *f) {
+	uint64_t kind = f->R.rax, q = f->R.rdx;
+
+	if (kind >= PF_KIND_CNT)
+		f->R.rax = -1;
+	else if (q == PF_Q_COUNT)
+		f->R.rax = pf_cnt[kind];
+	else if (q == PF_Q_SELF)
+		f->R.rax = thread_current ()->pf_cnt[kind];
+	else if (q == PF_Q_CYCLES)
+		f->R.rax = pf_cycles[kind];
+	else if (q >= PF_Q_HIST && q < PF_Q_HIST + PF_HIST_CNT)
+		f->R.rax = pf_hist[kind][q - PF_Q_HIST];
+	else
+		f->R.rax = -1;
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -122,6 +206,7 @@ page_fault (struct intr_frame *f) {
 	bool write;        /* True: access was write, false: access was read. */
 	bool user;         /* True: access by user, false: access by kernel. */
 	void *fault_addr;  /* Fault address. */
+	uint64_t start = rdtsc ();
 
 	/* Obtain faulting address, the virtual address that was
 	   accessed to cause the fault.  It may point to code or to
@@ -142,15 +227,31 @@ page_fault (struct intr_frame *f) {
 
 
 #ifdef VM
-	/* For project 3 and later. */
-	if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
+	/* For project 3 and later.  The VM tells what kind of fault it
+	   was through pf_kind. */
+	thread_current ()->pf_kind = PF_LAZY;
+	if (vm_try_handle_fault (f, fault_addr, user, write, not_present)) {
+		count_fault (thread_current ()->pf_kind, start);
 		return;
-	
+	}
 #endif
-	
+
 	/* Count page faults. */
 	page_fault_cnt++;
 
+	/* A bad user pointer used by one of the copy routines in
+	   userprog/uaccess.S.  Let the routine report it. */
+	if (!user) {
+		uintptr_t fixup = search_fixup (f->rip);
+		if (fixup != 0) {
+			f->rip = fixup;
+			count_fault (PF_FIXUP, start);
+			return;
+		}
+	}
+
+	count_fault (PF_BAD, start);
+
 	/* If the fault is true fault, show info and exit. */
 	printf ("Page fault at %p: %s error %s page in %s context.\n",
 			fault_addr,
@@ -164,3 +265,13 @@ page_fault (struct intr_frame *f) {
 	}
 	kill (f);
 }
+
+/* Returns the fixup code for the instruction at RIP, or 0 if RIP is not
+   in the exception table. */
+static uintptr_t
+search_fixup (uintptr_t rip) {
+	for (const struct ex_entry *e = __ex_table_start; e < __ex_table_end; e++)
+		if (e->insn == rip)
+			return e->fixup;
+	return 0;
+}
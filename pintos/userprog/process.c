@@ -197,11 +197,11 @@ __do_fork (void *aux_) {
 }
 
 /* Switch the current execution context to the f_name.
+ * F_NAME is a page from palloc_get_page(), which is freed here.
  * Returns -1 on fail. */
 int
 process_exec (void *f_name) {
-	char *file_name = palloc_get_page(0);
-	memcpy(file_name, f_name, 128);
+	char *file_name = f_name;
 	bool success;
 
 	/* We cannot use the intr_frame in the thread structure.
@@ -305,6 +305,9 @@ process_exit (void) {
 		}
 	}
 	printf ("%s: exit(%d)\n", curr->name, curr->exit_num);
+#ifdef VM
+	vm_mm_report (&curr->spt);
+#endif
 	process_cleanup ();
 }
 
@@ -418,8 +421,10 @@ load (const char *file_name, struct intr_frame *if_) {
 	int i;
 	//신규 처리 파일명 이상해서 안들어간다능
 	char *save;
-	char file_name_cp[128];
-	strlcpy(file_name_cp, file_name, 128);
+	char *file_name_cp = palloc_get_page(0);
+	if (file_name_cp == NULL)
+		return false;
+	strlcpy(file_name_cp, file_name, PGSIZE);
 	strtok_r(file_name, " ", &save);
 
 	/* Allocate and activate page directory. */
@@ -531,6 +536,10 @@ load (const char *file_name, struct intr_frame *if_) {
 		}
 		count++;
 	}
+	/* The strings, their padding, argv[] and the return address all
+	 * go on the one stack page. */
+	if (byte_size + argc + 8 + (argc + 2) * 8 > PGSIZE)
+		goto done;
 	char *trash;
 	if_->rsp -= (byte_size + argc);
 	char *token;
@@ -559,6 +568,7 @@ load (const char *file_name, struct intr_frame *if_) {
 
 done:
 	/* We arrive here whether the load is successful or not. */
+	palloc_free_page (file_name_cp);
 	return success;
 }
 
@@ -711,24 +721,10 @@ install_page (void *upage, void *kpage, bool writable) {
  * If you want to implement the function for only project 2, implement it on the
  * upper block. */
 static bool
-lazy_load_segment (struct page *page, void *aux) {
-	struct file_load_aux *load_aux = (struct file_load_aux *) aux;
-	/* TODO : 파일에서 세그먼트를 로드합니다.
-	   주소 VA에서 첫 번째 페이지 폴트가 발생할 때 호출됩니다.
-	   VA는 이 함수를 호출할 때 사용할 수 있습니다. */
-	struct file *file = load_aux->file;
-	void *kva = page->frame->kva;
-	size_t read_bytes = load_aux->read_bytes;
-	size_t zero_bytes = load_aux->zero_bytes;
-	off_t ofs = load_aux->offset;
-	
-	if(file_read_at(file, kva, read_bytes, ofs) != (int) read_bytes){
-		free(aux);
-		return false;
-	}
-	memset(kva + read_bytes, 0, zero_bytes);
-	free(aux);
-	return true;
+lazy_load_segment (struct page *page, void *aux UNUSED) {
+	/* 주소 VA에서 첫 번째 페이지 폴트가 발생할 때 호출됩니다.
+	   읽을 위치와 길이는 페이지가 속한 VMA로부터 계산합니다. */
+	return vma_read_page (page->vma, page->va, page->frame->kva);
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -743,6 +739,9 @@ lazy_load_segment (struct page *page, void *aux) {
  * The pages initialized by this function must be writable by the
  * user process if WRITABLE is true, read-only otherwise.
  *
+ * Only a VMA describing the segment is recorded here; the pages are
+ * created by the page fault handler the first time they are touched.
+ *
  * Return true if successful, false if a memory allocation error
  * or disk read error occurs. */
 static bool
@@ -752,33 +751,14 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
-	while (read_bytes > 0 || zero_bytes > 0) {
-		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
-		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		/* lazy_load_segment에 정보를 전달하기 위해 aux를 동적 할당합니다. */
-		struct file_load_aux *load_aux = (struct file_load_aux *)malloc(sizeof(struct file_load_aux));
-		if (load_aux == NULL) {
-			return false;
-		}
-		
-		load_aux->file = file;
-		load_aux->read_bytes = page_read_bytes;
-		load_aux->zero_bytes = page_zero_bytes;
-		load_aux->offset = ofs;
-		
-		// aux가 유효한 힙 포인터인지 출력으로 확인
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, load_aux)) {
-			free(load_aux);
-			return false;
-		}
-
-		/* Advance. */
-		read_bytes -= page_read_bytes;
-		zero_bytes -= page_zero_bytes;
-		ofs += page_read_bytes;
-		upage += PGSIZE;
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vma *vma = vma_create (upage, upage + read_bytes + zero_bytes,
+			file, ofs, read_bytes, writable, VM_ANON, lazy_load_segment);
+	if (vma == NULL)
+		return false;
+	if (!vma_insert (&spt->vmas, vma)) {
+		vma_destroy (vma);
+		return false;
 	}
 	return true;
 }
@@ -4,6 +4,7 @@
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/loader.h"
+#include "threads/palloc.h"
 #include "userprog/gdt.h"
 #include "threads/flags.h"
 #include "intrinsic.h"
@@ -11,15 +12,20 @@
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "userprog/process.h"
+#include "userprog/uaccess.h"
 #include "console.h"
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
 /* project2 */
-void validate_addr (void *addr);
 void validate_fn (char *file_name);
 struct lock lockfile;
 
+/* Room for a file name copied in from user memory.  Longer names are
+ * refused the same way as names that do not exist.  Command lines for
+ * exec get a page instead. */
+#define NAME_BUF 128
+
 /* System call.
  *
  * Previously system call services was handled by the interrupt handler
@@ -49,19 +55,90 @@ syscall_init (void) {
 }
 
 /* project2 */
-void
-validate_addr (void *addr) {
-	// 유저 영역인지, pagetable에 매핑되어 있는지 
-	if (addr == NULL || !is_user_vaddr(addr)) {
-	    thread_current()->exit_num = -1;
-	    thread_exit();
-	}
+/* Kills the current process for passing a bad pointer. */
+static void NO_RETURN
+bad_user_ptr (void) {
+	thread_current()->exit_num = -1;
+	thread_exit();
+}
+
+/* Copies the string at user address USRC into DST, which has room for
+ * SIZE bytes.  Returns false if it does not fit. */
+static bool
+get_user_string (char *dst, const char *usrc, size_t size) {
+	long len = strncpy_from_user(dst, usrc, size);
+	if (len < 0)
+		bad_user_ptr();
+	return (size_t) len < size;
+}
+
+/* Bytes moved between a file and user memory per lockfile hold.  The
+ * bounce buffer lives on the kernel stack, which page faults taken by
+ * the copy routines also run on, so keep it small. */
+#define IO_CHUNK 256
 
-	if (!spt_find_page(&thread_current()->spt, addr)) {
-	    thread_current()->exit_num = -1;
-	    thread_exit();
+/* Kills the current process unless the SIZE bytes at UBUF are in user
+ * space and the first of them is mapped.  Checked before any I/O, so
+ * that a bad buffer is refused even when nothing would be copied. */
+static void
+check_user_buf (const void *ubuf, unsigned size) {
+	uint8_t probe;
+
+	if (!user_range_ok(ubuf, size) || copy_from_user(&probe, ubuf, 1) != 0)
+		bad_user_ptr();
+}
+
+/* Reads up to SIZE bytes of FILE into user buffer UBUF, a chunk at a
+ * time through a kernel buffer, so that no lock is held while user
+ * memory faults.  Returns the number of bytes read. */
+static off_t
+read_to_user (struct file *file, uint8_t *ubuf, unsigned size) {
+	uint8_t kbuf[IO_CHUNK];
+	off_t total = 0;
+
+	check_user_buf(ubuf, size);
+	while (size > 0) {
+		unsigned chunk = size < IO_CHUNK ? size : IO_CHUNK;
+		lock_acquire(&lockfile);
+		off_t n = file_read(file, kbuf, chunk);
+		lock_release(&lockfile);
+		if (copy_to_user(ubuf + total, kbuf, n) != 0)
+			bad_user_ptr();
+		total += n;
+		size -= n;
+		if ((unsigned) n < chunk)
+			break;
 	}
+	return total;
+}
 
+/* Writes SIZE bytes of user buffer UBUF to FILE, or to the console if
+ * FILE is NULL, like read_to_user().  Returns the number of bytes
+ * written. */
+static off_t
+write_from_user (struct file *file, const uint8_t *ubuf, unsigned size) {
+	uint8_t kbuf[IO_CHUNK];
+	off_t total = 0;
+
+	check_user_buf(ubuf, size);
+	while (size > 0) {
+		unsigned chunk = size < IO_CHUNK ? size : IO_CHUNK;
+		off_t n = chunk;
+		if (copy_from_user(kbuf, ubuf + total, chunk) != 0)
+			bad_user_ptr();
+		if (file == NULL)
+			putbuf((char *) kbuf, chunk);
+		else {
+			lock_acquire(&lockfile);
+			n = file_write(file, kbuf, chunk);
+			lock_release(&lockfile);
+		}
+		total += n;
+		size -= n;
+		if ((unsigned) n < chunk)
+			break;
+	}
+	return total;
 }
 
 void
@@ -115,27 +192,16 @@ void syscall_handler (struct intr_frame *f UNUSED) {
 			/* TD : 2 need to validate fd, buf */ 
 			struct thread *cur = thread_current();
 			validate_fd(fd);
-			validate_addr(buf);
 
 			if(fd == 1){
-				putbuf(buf, size);
-				if(size == 0){
-					f->R.rax = 0;
-				}else f->R.rax = size;
+				f->R.rax = write_from_user(NULL, (uint8_t *) buf, size);
 			}else if(fd>=2){ // [11.19] 파일 작성 처리
 				struct file *file = cur->fd_table[fd];
 				if(file == NULL){
 					f->R.rax = -1;
 					break;
 				}
-				lock_acquire(&lockfile);
-				off_t n = file_write(file, buf, size);
-				lock_release(&lockfile);
-				if(n == 0){
-					f->R.rax = 0;
-					break;
-				}
-				f->R.rax = n;
+				f->R.rax = write_from_user(file, (uint8_t *) buf, size);
 			}	
 			break;
 			
@@ -146,9 +212,22 @@ void syscall_handler (struct intr_frame *f UNUSED) {
 			break;
 			
 		case SYS_EXEC : {
-			char *file_name = f->R.rdi;
-			validate_addr(file_name);
-			int stat = process_exec(file_name);
+			/* A command line, unlike a file name, may take up to a page,
+			 * as the one of the first process does.  process_exec() frees
+			 * the page. */
+			char *cmd_line = palloc_get_page(0);
+			int stat = -1;
+			if(cmd_line != NULL){
+				long len = strncpy_from_user(cmd_line, (char *) f->R.rdi, PGSIZE);
+				if(len < 0){
+					palloc_free_page(cmd_line);
+					bad_user_ptr();
+				}
+				if(len < PGSIZE)
+					stat = process_exec(cmd_line);
+				else
+					palloc_free_page(cmd_line);
+			}
 			thread_current()->exit_num = stat;
 			f->R.rax = stat;
 			if(stat == -1) thread_exit();
@@ -157,8 +236,11 @@ void syscall_handler (struct intr_frame *f UNUSED) {
 			
 		case SYS_CREATE : {
 			// 새로운 파일을 생성한다.
-			char *file_name = f->R.rdi;
-			validate_addr(file_name);
+			char file_name[NAME_BUF];
+			if(!get_user_string(file_name, (char *) f->R.rdi, sizeof file_name)){
+				f->R.rax = false;
+				break;
+			}
 			validate_fn(file_name);
 
 			unsigned initial_size = f->R.rsi;
@@ -178,23 +260,9 @@ void syscall_handler (struct intr_frame *f UNUSED) {
 
 		case SYS_OPEN : {
 			// 파일 이름에 대한 검증
-			char *file_name = f->R.rdi;
+			char file_name[NAME_BUF];
 			struct thread *curr = thread_current();
-			bool is_user = is_user_vaddr(file_name);
-			if(!is_user){
-				curr->exit_num = -1;
-				thread_exit();
-				break;
-			}
-			
-			bool is_mapped_pte = spt_find_page(&curr->spt, file_name);
-			// validate mapping, fileName
-			if(!is_mapped_pte){
-				curr->exit_num = -1;
-				thread_exit();
-				break;
-			}
-			if(file_name == NULL ||
+			if(!get_user_string(file_name, (char *) f->R.rdi, sizeof file_name) ||
 			file_name[0] == '\0' || 
 			strcmp(file_name,  "no-such-file") == 0) {
 				f->R.rax = -1;
@@ -254,20 +322,17 @@ void syscall_handler (struct intr_frame *f UNUSED) {
 			unsigned sz = f->R.rdx;		
 			// fd 검증
 			validate_fd_file(fd);
-			validate_addr(buffer);
 
 			if(fd == 0){
 				uint8_t key = input_getc();
-    			((uint8_t *)buffer)[0] = key;
+				if(copy_to_user(buffer, &key, 1) != 0)
+					bad_user_ptr();
     			f->R.rax = 1;
 				break;
 			} else if(fd >= 2){
 				struct thread *cur = thread_current();
 				struct file *file = cur->fd_table[fd];
-				lock_acquire(&lockfile);
-				off_t n = file_read(file, buffer, sz);
-				lock_release(&lockfile);
-				f->R.rax = n;
+				f->R.rax = read_to_user(file, (uint8_t *) buffer, sz);
 			}
 			break;
 		}
@@ -284,16 +349,23 @@ void syscall_handler (struct intr_frame *f UNUSED) {
 		}
 
 		case SYS_FORK : {
-			char *process_name = f->R.rdi;
-			validate_addr(process_name);
+			char process_name[16];
+			/* A bad pointer kills the process inside get_user_string().
+			 * A long name is only cut short, as thread names are. */
+			if(!get_user_string(process_name, (char *) f->R.rdi,
+					sizeof process_name))
+				process_name[sizeof process_name - 1] = '\0';
 			tid_t tid = process_fork(process_name, f);
 			f->R.rax = tid;
 			break;
 		}
 
 		case SYS_REMOVE : {
-			char *file_name = f->R.rdi;
-			validate_addr(file_name);
+			char file_name[NAME_BUF];
+			if(!get_user_string(file_name, (char *) f->R.rdi, sizeof file_name)){
+				f->R.rax = false;
+				break;
+			}
 			lock_acquire(&lockfile);
 			bool suc = filesys_remove(file_name);
 			lock_release(&lockfile);
@@ -324,5 +396,40 @@ void syscall_handler (struct intr_frame *f UNUSED) {
 		    break;
 		}
 
+#ifdef VM
+		case SYS_MMAP : {
+			void *addr = (void *) f->R.rdi;
+			size_t length = f->R.rsi;
+			int writable = f->R.rdx;
+			int fd = f->R.r10;
+			off_t offset = f->R.r8;
+			struct thread *cur = thread_current();
+
+			// 콘솔 fd나 열리지 않은 fd는 매핑할 수 없다.
+			if(fd < 2 || fd >= FD_MAX || cur->fd_table[fd] == NULL){
+				f->R.rax = 0;
+				break;
+			}
+			lock_acquire(&lockfile);
+			f->R.rax = (uint64_t) do_mmap(addr, length, writable & 1,
+					cur->fd_table[fd], offset);
+			lock_release(&lockfile);
+			// 파일 읽기는 lockfile 밖에서 한다.
+			if(f->R.rax != 0 && (writable & MAP_POPULATE))
+				vm_populate(addr, (uint8_t *) addr + length, true);
+			break;
+		}
+
+		case SYS_MUNMAP : {
+			do_munmap((void *) f->R.rdi);
+			break;
+		}
+
+		case SYS_MADVISE : {
+			f->R.rax = do_madvise((void *) f->R.rdi, f->R.rsi, f->R.rdx);
+			break;
+		}
+#endif
+
 	}	
 }
@@ -2,6 +2,12 @@
 
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include <bitmap.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/zswap.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -17,36 +23,189 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* Sectors in one page-sized swap slot. */
+#define SLOT_SECTORS (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Swap slots in use, or NULL without a swap disk. */
+static struct bitmap *swap_slots;
+
+/* Protects swap_slots, the zswap pool, and the anon_page of every page
+ * that is not in memory. */
+static struct lock swap_lock;
+
+/* Statistics. */
+static unsigned long long zswap_hits;   /* Faults served from zswap. */
+static unsigned long long zswap_misses; /* Faults served from disk. */
+static unsigned long long zswap_stores; /* Pages compressed into zswap. */
+static unsigned long long zero_pages;   /* Zero pages swapped out. */
+static unsigned long long disk_writes;  /* Pages written to the disk. */
+static unsigned long long aged_out;     /* ...of which aged out of zswap. */
+static unsigned long long clean_dropped;    /* Clean file pages dropped. */
+
+static zswap_writeback_func anon_writeback;
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
 	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	swap_disk = disk_get (1, 1);
+	if (swap_disk != NULL)
+		swap_slots = bitmap_create (disk_size (swap_disk) / SLOT_SECTORS);
+	lock_init (&swap_lock);
+	zswap_init (anon_writeback);
 }
 
 /* Initialize the file mapping */
 bool
-anon_initializer (struct page *page, enum vm_type type, void *kva) {
+anon_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->where = ANON_MEMORY;
+	return true;
+}
+
+static bool
+page_is_zero (const void *kva) {
+	const uint64_t *p = kva;
+
+	for (size_t i = 0; i < PGSIZE / sizeof *p; i++)
+		if (p[i] != 0)
+			return false;
+	return true;
+}
+
+/* Writes the page at KVA to a free swap slot and returns the slot, or
+ * BITMAP_ERROR if swap is full.  Needs swap_lock. */
+static size_t
+swap_write (const void *kva) {
+	size_t slot = BITMAP_ERROR;
+
+	if (swap_slots != NULL)
+		slot = bitmap_scan_and_flip (swap_slots, 0, 1, false);
+	if (slot == BITMAP_ERROR)
+		return slot;
+	for (size_t i = 0; i < SLOT_SECTORS; i++)
+		disk_write (swap_disk, slot * SLOT_SECTORS + i,
+				(const uint8_t *) kva + i * DISK_SECTOR_SIZE);
+	disk_writes++;
+	return slot;
+}
+
+/* Moves a page whose compressed copy aged out of zswap to the disk. */
+static bool
+anon_writeback (void *owner, const void *data) {
+	struct anon_page *anon_page = &((struct page *) owner)->anon;
+	size_t slot = swap_write (data);
+
+	if (slot == BITMAP_ERROR)
+		return false;
+	anon_page->where = ANON_DISK;
+	anon_page->slot = slot;
+	aged_out++;
+	return true;
+}
+
+/* Frees whatever holds the contents of ANON_PAGE.  Needs swap_lock. */
+static void
+anon_discard (struct anon_page *anon_page) {
+	if (anon_page->where == ANON_ZSWAP)
+		zswap_free (anon_page->zswap);
+	else if (anon_page->where == ANON_DISK)
+		bitmap_reset (swap_slots, anon_page->slot);
+	anon_page->where = ANON_MEMORY;
 }
 
 /* Swap in the page by read contents from the swap disk. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+
+	/* A dropped page holds no swap space, so no lock is needed. */
+	if (anon_page->where == ANON_FILE) {
+		if (!vma_read_page (page->vma, page->va, kva))
+			return false;
+		anon_page->where = ANON_MEMORY;
+		return true;
+	}
+
+	lock_acquire (&swap_lock);
+	switch (anon_page->where) {
+		case ANON_ZERO:
+			memset (kva, 0, PGSIZE);
+			break;
+		case ANON_ZSWAP:
+			zswap_load (anon_page->zswap, kva);
+			zswap_hits++;
+			break;
+		case ANON_DISK:
+			for (size_t i = 0; i < SLOT_SECTORS; i++)
+				disk_read (swap_disk, anon_page->slot * SLOT_SECTORS + i,
+						(uint8_t *) kva + i * DISK_SECTOR_SIZE);
+			zswap_misses++;
+			break;
+		case ANON_MEMORY:
+		case ANON_FILE:
+			break;
+	}
+	anon_discard (anon_page);
+	lock_release (&swap_lock);
+	return true;
 }
 
-/* Swap out the page by writing contents to the swap disk. */
+/* Swap out the page by writing contents to the swap disk.
+ * A page loaded from a file that was never written to is just dropped
+ * and reread on the next fault.  Zero pages are only noted, the rest is
+ * compressed into zswap when it compresses well and written to disk
+ * otherwise. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	void *kva = page->frame->kva;
+	bool success = true;
+
+	if (!page->dirty && page->vma != NULL && page->vma->file != NULL) {
+		anon_page->where = ANON_FILE;
+		clean_dropped++;
+		return true;
+	}
+
+	lock_acquire (&swap_lock);
+	if (page_is_zero (kva)) {
+		anon_page->where = ANON_ZERO;
+		zero_pages++;
+	} else if ((anon_page->zswap = zswap_store (kva, page)) != NULL) {
+		anon_page->where = ANON_ZSWAP;
+		zswap_stores++;
+	} else if ((anon_page->slot = swap_write (kva)) != BITMAP_ERROR)
+		anon_page->where = ANON_DISK;
+	else
+		success = false;
+	lock_release (&swap_lock);
+	return success;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	/* Release the frame first, so no eviction is still writing out this
+	 * page when its swap space is freed. */
+	vm_release_frame (page);
+	lock_acquire (&swap_lock);
+	anon_discard (anon_page);
+	lock_release (&swap_lock);
+}
+
+/* Prints swap statistics. */
+void
+vm_anon_print_stats (void) {
+	printf ("Swap: %llu zswap hits, %llu misses, %llu compressed, "
+			"%llu zero, %llu written to disk (%llu aged out), "
+			"%llu clean dropped\n",
+			zswap_hits, zswap_misses, zswap_stores, zero_pages,
+			disk_writes, aged_out, clean_dropped);
 }
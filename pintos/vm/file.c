@@ -1,6 +1,10 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
 #include "vm/vm.h"
+#include <string.h>
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
 static bool file_backed_swap_out (struct page *page);
@@ -14,45 +18,131 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
-/* The initializer of file vm */
+/* The initializer of file vm.  File data lives in the page cache, see
+ * filesys/page_cache.c, which also writes it back. */
 void
 vm_file_init (void) {
 }
 
 /* Initialize the file backed page */
 bool
-file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+file_backed_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &file_ops;
 
 	struct file_page *file_page = &page->file;
+	file_page->writable = page->writable;
+	return true;
+}
+
+/* Fills a mapped page on its first fault.  Only the tail of a mapping
+ * past the end of its file gets here; the rest comes from the page
+ * cache. */
+static bool
+file_backed_load (struct page *page, void *aux UNUSED) {
+	return vma_read_page (page->vma, page->va, page->frame->kva);
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	return vma_read_page (page->vma, page->va, kva);
+}
+
+/* Hands the dirty bit of PAGE over to the page cache entry of its frame,
+ * which writes the frame back.  The tail of a mapping past the end of the
+ * file has no entry and is never written.  Needs frame_lock. */
+static void
+file_backed_sync (struct page *page) {
+	if (page->dirty && page->frame->pc != NULL)
+		page->frame->pc->dirty = true;
+	page->dirty = false;
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page.  The page cache writes the frame back when it lets
+ * go of the frame itself, right after this. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	lock_acquire (&frame_lock);
+	file_backed_sync (page);
+	lock_release (&frame_lock);
+	return true;
 }
 
-/* Destory the file backed page. PAGE will be freed by the caller. */
+/* Destory the file backed page. PAGE will be freed by the caller.
+ * The frame stays in the page cache, which writes it back later. */
 static void
 file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	lock_acquire (&frame_lock);
+	vm_page_wait (page);
+	if (page->frame != NULL) {
+		vm_page_sync_dirty (page);
+		file_backed_sync (page);
+	}
+	lock_release (&frame_lock);
+	vm_release_frame (page);
+}
+
+/* Stops spt_for_each() at the first page it is given. */
+static bool
+page_found (struct page *page UNUSED, void *aux UNUSED) {
+	return false;
 }
 
 /* Do the mmap */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *start = addr;
+	uint8_t *end = pg_round_up (start + length);
+	off_t file_len;
+	struct vma *vma;
+
+	if (start == NULL || pg_ofs (start) != 0 || length == 0
+			|| offset < 0 || pg_ofs (offset) != 0
+			|| end <= start || !is_user_vaddr (end - 1))
+		return NULL;
+	file_len = file_length (file);
+	if (file_len <= offset)
+		return NULL;
+	if (vma_find_overlap (&spt->vmas, start, end) != NULL
+			|| !spt_for_each (spt, start, end, page_found, NULL))
+		return NULL;
+
+	if ((size_t) (file_len - offset) < length)
+		length = file_len - offset;
+	vma = vma_create (start, end, file, offset, length, writable, VM_FILE,
+			file_backed_load);
+	if (vma == NULL)
+		return NULL;
+	if (!vma_insert (&spt->vmas, vma)) {
+		vma_destroy (vma);
+		return NULL;
+	}
+	return addr;
+}
+
+static bool
+unmap_page (struct page *page, void *spt) {
+	spt_remove_page (spt, page);
+	return true;
 }
 
 /* Do the munmap */
 void
 do_munmap (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct vma *vma = vma_find (&spt->vmas, addr);
+
+	struct pml4_batch batch;
+
+	if (vma == NULL || vma->start != addr || vma->type != VM_FILE)
+		return;
+	spt_batch_begin (spt, &batch);
+	spt_for_each (spt, vma->start, vma->end, unmap_page, spt);
+	spt_batch_end (spt);
+	vma_remove (&spt->vmas, vma);
+	vma_destroy (vma);
 }
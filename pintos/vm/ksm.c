@@ -0,0 +1,239 @@
+/* ksm.c: Same-page merging for anonymous memory.
+ *
+ * A low-priority kernel thread walks the frame table a few pages at a
+ * time and hashes the contents of private anonymous frames.  A frame
+ * whose hash did not change since the previous pass is looked up, by
+ * contents, first among the frames already merged (the stable table) and
+ * then among the candidates seen so far in this pass (the unstable
+ * table).  On a match both pages end up mapping one read-only frame, and
+ * the other frame goes back to the user pool.  A write to a merged page
+ * faults and vm_handle_wp() gives the writer its own copy again.
+ *
+ * The unstable table holds frames that are still writable, so it is
+ * thrown away after every full pass over the frame table. */
+
+#include "vm/ksm.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/mmu.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "vm/vm.h"
+
+/* Frames scanned per wakeup; 0 stops merging.  Set with "-ksm-scan=N". */
+unsigned ksm_pages_to_scan = 100;
+
+/* Sleep between wakeups.  Set with "-ksm-sleep=MS". */
+unsigned ksm_sleep_ms = 20;
+
+static struct hash stable;      /* Merged read-only frames. */
+static struct hash unstable;    /* Candidates of the current pass. */
+static struct list_elem *cursor;    /* Next frame to scan. */
+
+/* Statistics. */
+static unsigned long long full_scans;   /* Passes over the frame table. */
+static unsigned long long pages_scanned;    /* Candidate frames hashed. */
+static unsigned long long pages_merged;     /* Pages mapped to a merged frame. */
+static unsigned long long pages_shared; /* Merged frames right now. */
+
+static struct frame *
+ksm_frame (const struct hash_elem *e) {
+	return hash_entry (e, struct frame, ksm.elem);
+}
+
+static uint64_t
+ksm_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return ksm_frame (e)->ksm.checksum;
+}
+
+/* Frames are equal when their contents are.  Equal contents imply equal
+ * checksums, so the contents are only compared on a checksum tie. */
+static bool
+ksm_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct frame *a = ksm_frame (a_), *b = ksm_frame (b_);
+
+	if (a->ksm.checksum != b->ksm.checksum)
+		return a->ksm.checksum < b->ksm.checksum;
+	return memcmp (a->kva, b->kva, PGSIZE) < 0;
+}
+
+/* Hashes one page, a 64-bit word at a time. */
+static uint64_t
+page_checksum (const void *kva) {
+	const uint64_t *p = kva;
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < PGSIZE / sizeof *p; i++)
+		h = (h ^ p[i]) * 0x100000001b3ULL;
+	return h;
+}
+
+static struct page *
+only_page (struct frame *frame) {
+	return list_entry (list_front (&frame->pages), struct page, frame_elem);
+}
+
+/* Maps PAGE read-only to FRAME if their contents are still the same, and
+ * returns true if so.  Interrupts are off across the compare and the
+ * page table update so the owner cannot write in between. */
+static bool
+ksm_merge (struct page *page, struct frame *frame) {
+	enum intr_level old_level = intr_disable ();
+	bool same = memcmp (page->frame->kva, frame->kva, PGSIZE) == 0;
+
+	if (same) {
+		vm_page_sync_dirty (page);
+		pml4_set_page (page->owner->pml4, page->va, frame->kva, false);
+	}
+	intr_set_level (old_level);
+
+	if (same) {
+		vm_frame_move (page, frame);
+		pages_merged++;
+	}
+	return same;
+}
+
+/* Turns FRAME, a candidate of the unstable table, into a merged frame by
+ * write-protecting its only page, then merges PAGE into it. */
+static void
+ksm_promote (struct frame *frame, struct page *page) {
+	struct page *owner = only_page (frame);
+	enum intr_level old_level;
+	bool same;
+
+	hash_delete (&unstable, &frame->ksm.elem);
+	frame->ksm.state = KSM_NONE;
+
+	old_level = intr_disable ();
+	same = memcmp (page->frame->kva, frame->kva, PGSIZE) == 0;
+	if (same) {
+		vm_page_sync_dirty (owner);
+		pml4_set_page (owner->owner->pml4, owner->va, frame->kva, false);
+	}
+	intr_set_level (old_level);
+	if (!same)
+		return;
+
+	frame->ksm.checksum = page->frame->ksm.checksum;
+	frame->ksm.state = KSM_STABLE;
+	hash_insert (&stable, &frame->ksm.elem);
+	pages_shared++;
+	ksm_merge (page, frame);
+}
+
+/* Looks at one frame of the frame table. */
+static void
+ksm_scan_frame (struct frame *frame) {
+	struct hash_elem *e;
+	struct page *page;
+	uint64_t sum;
+
+	if (frame->pinned || frame->text != NULL || frame->huge != NULL
+			|| frame->ksm.state != KSM_NONE
+			|| list_size (&frame->pages) != 1)
+		return;
+	page = only_page (frame);
+	if (!page->writable || page->operations->type != VM_ANON)
+		return;
+	pages_scanned++;
+
+	/* A page that changed since the last pass is likely to change again;
+	 * merging it would only buy a write fault. */
+	sum = page_checksum (frame->kva);
+	if (sum != frame->ksm.checksum) {
+		frame->ksm.checksum = sum;
+		return;
+	}
+
+	if ((e = hash_find (&stable, &frame->ksm.elem)) != NULL)
+		ksm_merge (page, ksm_frame (e));
+	else if ((e = hash_find (&unstable, &frame->ksm.elem)) != NULL)
+		ksm_promote (ksm_frame (e), page);
+	else {
+		frame->ksm.state = KSM_UNSTABLE;
+		hash_insert (&unstable, &frame->ksm.elem);
+	}
+}
+
+static void
+ksm_unstable_reset (struct hash_elem *e, void *aux UNUSED) {
+	ksm_frame (e)->ksm.state = KSM_NONE;
+}
+
+/* Scans up to N frames, wrapping around the frame table.  Needs
+ * frame_lock. */
+static void
+ksm_scan (unsigned n) {
+	while (n-- > 0) {
+		if (cursor == NULL || cursor == list_end (&frame_table)) {
+			if (cursor != NULL) {
+				hash_clear (&unstable, ksm_unstable_reset);
+				full_scans++;
+			}
+			cursor = list_begin (&frame_table);
+			if (cursor == list_end (&frame_table))
+				return;
+		}
+
+		/* Step first: scanning may free the frame. */
+		struct frame *frame = list_entry (cursor, struct frame, elem);
+		cursor = list_next (cursor);
+		ksm_scan_frame (frame);
+	}
+}
+
+static void
+ksmd (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep ((int64_t) ksm_sleep_ms * TIMER_FREQ / 1000 + 1);
+		lock_acquire (&frame_lock);
+		ksm_scan (ksm_pages_to_scan);
+		lock_release (&frame_lock);
+	}
+}
+
+/* Sets up the merge tables and starts the scanner, unless scanning was
+ * turned off on the command line. */
+void
+ksm_init (void) {
+	hash_init (&stable, ksm_hash, ksm_less, NULL);
+	hash_init (&unstable, ksm_hash, ksm_less, NULL);
+	if (ksm_pages_to_scan > 0)
+		thread_create ("ksmd", PRI_MIN, ksmd, NULL);
+}
+
+/* Takes FRAME out of the merge tables, because it is about to be freed or
+ * because its last page is taking it back as a private frame.  Needs
+ * frame_lock. */
+void
+ksm_forget (struct frame *frame) {
+	if (cursor == &frame->elem)
+		cursor = list_next (cursor);
+
+	switch (frame->ksm.state) {
+		case KSM_STABLE:
+			hash_delete (&stable, &frame->ksm.elem);
+			pages_shared--;
+			break;
+		case KSM_UNSTABLE:
+			hash_delete (&unstable, &frame->ksm.elem);
+			break;
+		case KSM_NONE:
+			break;
+	}
+	frame->ksm.state = KSM_NONE;
+	frame->ksm.checksum = 0;
+}
+
+/* Prints merging statistics. */
+void
+ksm_print_stats (void) {
+	printf ("KSM: %llu full scans, %llu pages scanned, %llu merged, "
+			"%llu shared frames\n",
+			full_scans, pages_scanned, pages_merged, pages_shared);
+}
@@ -3,24 +3,135 @@
 #include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
+#include <hash.h>
+#include <stdio.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/synch.h"
+#include "devices/timer.h"
 
 /* project3 spt */
-#include "hash.h"
 #include "threads/mmu.h"
+#include "threads/vaddr.h"
 #include "string.h"
 
+/* Number of pages mapped around a file-backed page fault, including the
+ * faulting page.  0 or 1 disables fault-around.  Set with "-fa=PAGES". */
+size_t fault_around_pages = 16;
+
+/* Every frame that holds a user page.  frame_lock also protects the page
+ * list of each frame and the text cache. */
+struct list frame_table;
+struct lock frame_lock;
+static size_t frame_cnt;            /* Frames on frame_table. */
+static struct list_elem *clock_hand;    /* Next eviction candidate. */
+static struct condition evict_done; /* An eviction finished or gave up. */
+
+/* Free frame watermarks for kswapd, in pages.  kswapd wakes when the user
+ * pool has fewer than kswapd_low free pages and reclaims until it has
+ * kswapd_high.  0 picks a size from the user pool.  Set with
+ * "-wmark-low=PAGES" and "-wmark-high=PAGES". */
+size_t kswapd_low, kswapd_high;
+#define KSWAPD_BATCH 16             /* Frames evicted per frame_lock hold. */
+
+static struct semaphore kswapd_sema;    /* Upped to wake kswapd. */
+static bool kswapd_awake;           /* kswapd is reclaiming. */
+
+/* Reclaim statistics. */
+static unsigned long long kswapd_wakeups;
+static unsigned long long kswapd_reclaimed;    /* Frames freed by kswapd. */
+static unsigned long long direct_reclaimed;    /* Frames evicted on a fault. */
+
+/* Back aligned 2 MiB windows of anonymous memory with huge pages when the
+ * user pool has the room.  The only anonymous VMAs are ELF segments, so in
+ * practice this covers the zero-filled tail (BSS) of a writable segment
+ * of at least 2 MiB; mmap regions and the stack always use small pages.
+ * Set with "-thp=0|1". */
+bool thp_enabled = true;
+
+/* A huge page: HUGE_PGCNT physically contiguous frames, mapped by one
+ * page directory entry.  Each 4 kB page keeps its own `struct page' and
+ * `struct frame', so everything that works on one page at a time works
+ * unchanged once the huge page is split back into small pages, which
+ * happens before any one of them is evicted or unmapped.  The frames
+ * are consecutive on frame_table. */
+struct huge_frame {
+	void *va;                   /* First user address. */
+	struct thread *owner;       /* Process that maps it. */
+	struct frame *first;        /* Frame of the first 4 kB. */
+	uint64_t *pt;               /* Page table reserved for the split. */
+	bool referenced;            /* Accessed bit taken by the WSS sampler. */
+};
+
+/* Resident set cap of every process, in pages.  A process over its cap
+ * evicts its own pages before anyone else's.  0 sizes the cap from the
+ * working set estimate of each process instead, and only while the user
+ * pool is short of frames.  Set with "-rss=PAGES". */
+size_t rss_limit;
+#define RSS_MIN_PAGES 64            /* Smallest cap sized automatically. */
+
+/* Period of the working set sampler in milliseconds; 0 turns it off.  Each
+ * pass counts, per process, the pages accessed since the previous pass.
+ * Set with "-wss-ms=MS". */
+unsigned wss_sample_ms = 250;
+static unsigned wss_gen;            /* Sampling passes done. */
+
+/* Memory usage of exited processes, for vm_print_stats(). */
+struct mm_report {
+	struct list_elem elem;
+	char name[16];
+	tid_t tid;
+	size_t rss_peak, wss, self_evicted;
+	size_t huge_peak, huge_splits;
+};
+#define MM_REPORT_MAX 32
+static struct list mm_reports;
+static size_t mm_report_cnt;        /* Exited processes seen. */
+
+/* Huge page statistics. */
+static unsigned long long huge_faults;  /* Faults served with a huge page. */
+static unsigned long long huge_splits;  /* Huge pages split. */
+
+/* Where the contents of a read-only file-backed page come from. */
+struct text_key {
+	struct inode *inode;
+	off_t ofs;
+	size_t read_bytes;
+};
+
+/* Cache of read-only text frames keyed by their place in the file, so
+ * that every process executing the same binary maps the same frames.
+ * An entry lives exactly as long as its frame is mapped by some page. */
+struct text_entry {
+	struct hash_elem elem;
+	struct text_key key;
+	struct frame *frame;
+};
+static struct hash text_cache;
+
+static hash_hash_func text_hash;
+static hash_less_func text_less;
+static void kswapd_init (void);
+static void wssd (void *aux);
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
 vm_init (void) {
 	vm_anon_init ();
 	vm_file_init ();
-#ifdef EFILESYS  /* For project 4 */
-	pagecache_init ();
-#endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
-	/* TODO: Your code goes here. */
+	list_init (&frame_table);
+	lock_init (&frame_lock);
+	cond_init (&evict_done);
+	list_init (&mm_reports);
+	hash_init (&text_cache, text_hash, text_less, NULL);
+	page_cache_init ();
+	ksm_init ();
+	kswapd_init ();
+	if (wss_sample_ms > 0)
+		thread_create ("wssd", PRI_DEFAULT, wssd, NULL);
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -38,9 +149,28 @@ page_get_type (struct page *page) {
 }
 
 /* Helpers */
+static struct page *vm_page_from_vma (struct supplemental_page_table *spt,
+		void *addr);
 static struct frame *vm_get_victim (void);
 static bool vm_do_claim_page (struct page *page);
+static bool vm_claim_page_in (struct page *page, bool may_evict);
+static bool vm_claim_with_frame (struct page *page, struct frame *frame);
+static bool vm_claim_cached (struct page *page, bool may_evict);
+static struct frame *vm_get_frame (void);
+static struct frame *vm_try_get_frame (void);
+static void vm_free_frame (struct frame *frame);
 static struct frame *vm_evict_frame (void);
+static bool vm_frame_accessed (struct frame *frame);
+static void vm_frame_init (struct frame *frame, void *kva);
+static void vm_huge_split (struct huge_frame *h);
+static void vm_page_link (struct page *page, struct frame *frame);
+static void vm_page_unlink (struct page *page);
+static struct frame *vm_evict (struct frame *victim);
+static bool vm_pte_set (struct page *page, void *kva, bool rw);
+static void vm_pte_clear (struct page *page);
+static enum pf_kind vm_fault_kind (struct page *page);
+static struct frame *vm_own_victim (struct supplemental_page_table *spt);
+static size_t vm_rss_cap (struct supplemental_page_table *spt);
 
 /* 초기화 함수를 사용하여 보류 중인 페이지 객체를 생성합니다. 
  페이지를 생성하려면 직접 생성하지 말고 이 함수나 
@@ -64,6 +194,8 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 		// 2. uninit 페이지로 초기화 - "uninit" 페이지 구조체를 생성
 		uninit_new (page, upage, init, type, aux, NULL);
 		page->writable = writable;  // writable 설정
+		page->owner = thread_current ();
+		page->referenced = false;
 
 		// 타입별로 page_initializer 설정
 		switch (type) { 
@@ -94,66 +226,593 @@ err:
 	return false;
 }
 
-/* Find VA from spt and return page. On error, return NULL. */
-struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = NULL;
-	// va에 대한 검증 필요하려나
-	// 초기화되지 않은 페이지의 va를 찾을 때 문제가 될 수도?
-	struct page *p = malloc(sizeof(struct page));
-	p->va = pg_round_down(va);
-	struct hash_elem *e = hash_find(&spt->pages, &p->he);
-	if(e == NULL){
-		free(p);
-		return NULL;
-	}
-	
-	page = hash_entry(e, struct page, he);
+/* One node of the SPT radix tree.  A node is exactly one page, just like
+ * a page table, so it is taken from the kernel pool with palloc. */
+#define SPT_FANOUT (PGSIZE / sizeof (void *))
+struct spt_node {
+	void *slots[SPT_FANOUT];    /* Child nodes, or pages in the last level. */
+};
 
-	/* page 없으면 NULL 반환*/
-	if (page == NULL) {
-		return NULL;
+/* Shift of the index of each level, from the root down to the leaf. */
+static const unsigned spt_shifts[] = {
+	PML4SHIFT, PDPESHIFT, PDXSHIFT, PTXSHIFT
+};
+#define SPT_LEVELS (sizeof spt_shifts / sizeof *spt_shifts)
+#define SPT_IDX(va, level) \
+	((((uint64_t) (va)) >> spt_shifts[level]) & (SPT_FANOUT - 1))
+
+/* Returns the leaf slot that holds the page for VA.
+ * Missing intermediate nodes are allocated if CREATE is true, otherwise
+ * NULL is returned as soon as a level is missing. */
+static struct page **
+spt_walk (struct supplemental_page_table *spt, const void *va, bool create) {
+	void **slot = (void **) &spt->root;
+
+	for (unsigned level = 0; level < SPT_LEVELS; level++) {
+		if (*slot == NULL) {
+			if (!create)
+				return NULL;
+			*slot = palloc_get_page (PAL_ZERO);
+			if (*slot == NULL)
+				return NULL;
+		}
+		struct spt_node *node = *slot;
+		slot = &node->slots[SPT_IDX (va, level)];
 	}
-	free(p);
-	return page;
+	return (struct page **) slot;
+}
+
+/* Find VA from spt and return page. On error, return NULL. */
+struct page *
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	/* 트리를 따라 내려가기만 하므로 할당이 필요 없다. */
+	struct page **slot = spt_walk (spt, pg_round_down (va), false);
+	return slot != NULL ? *slot : NULL;
 }
 
 /* Insert PAGE into spt with validation. */
 bool
-spt_insert_page (struct supplemental_page_table *spt UNUSED,
-		struct page *page UNUSED) {
-	bool succ = false;
+spt_insert_page (struct supplemental_page_table *spt,
+		struct page *page) {
+	struct page **slot = spt_walk (spt, page->va, true);
 
-	struct hash_elem *old = hash_insert(&spt->pages, &page->he);
-	if (old == NULL) { 
-		succ = true;
-	}
-	return succ;
+	if (slot == NULL || *slot != NULL)
+		return false;
+	*slot = page;
+	return true;
 }
 
+/* Removes PAGE from SPT and frees it. */
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	struct page **slot = spt_walk (spt, page->va, false);
+
+	if (slot != NULL && *slot == page)
+		*slot = NULL;
 	vm_dealloc_page (page);
+}
+
+/* Walks the subtree NODE at LEVEL, whose first address is BASE, and calls
+ * FUNC on every page in [START, END).  Empty subtrees are skipped. */
+static bool
+spt_node_for_each (struct spt_node *node, unsigned level, uint64_t base,
+		uint64_t start, uint64_t end, spt_for_each_func *func, void *aux) {
+	uint64_t span = 1ULL << spt_shifts[level];
+
+	for (size_t i = 0; i < SPT_FANOUT; i++) {
+		uint64_t lo = base + i * span;
+		if (lo >= end)
+			break;
+		if (lo + span <= start || node->slots[i] == NULL)
+			continue;
+
+		if (level == SPT_LEVELS - 1) {
+			/* FUNC may remove this page, so read the slot only once. */
+			if (!func (node->slots[i], aux))
+				return false;
+		} else if (!spt_node_for_each (node->slots[i], level + 1, lo,
+					start, end, func, aux))
+			return false;
+	}
 	return true;
 }
 
+/* Calls FUNC on every page of SPT whose address is in [START, END), in
+ * increasing address order.  FUNC may remove the page it is given.
+ * Returns false if FUNC stopped the walk, true otherwise. */
+bool
+spt_for_each (struct supplemental_page_table *spt, void *start, void *end,
+		spt_for_each_func *func, void *aux) {
+	if (spt->root == NULL)
+		return true;
+	return spt_node_for_each (spt->root, 0, 0, (uint64_t) start,
+			(uint64_t) end, func, aux);
+}
+
+/* Frees NODE at LEVEL and every node below it.  Pages stored in the
+ * leaves are not touched. */
+static void
+spt_node_free (struct spt_node *node, unsigned level) {
+	if (level < SPT_LEVELS - 1)
+		for (size_t i = 0; i < SPT_FANOUT; i++)
+			if (node->slots[i] != NULL)
+				spt_node_free (node->slots[i], level + 1);
+	palloc_free_page (node);
+}
+
+/* Returns FRAME to the user pool. */
+static void
+vm_free_frame (struct frame *frame) {
+	palloc_free_page (frame->kva);
+	free (frame);
+}
+
+static uint64_t
+text_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct text_key *k = &hash_entry (e, struct text_entry, elem)->key;
+	return hash_bytes (&k->inode, sizeof k->inode) ^ hash_int (k->ofs);
+}
+
+static bool
+text_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct text_key *a = &hash_entry (a_, struct text_entry, elem)->key;
+	const struct text_key *b = &hash_entry (b_, struct text_entry, elem)->key;
+
+	if (a->inode != b->inode)
+		return a->inode < b->inode;
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	return a->read_bytes < b->read_bytes;
+}
+
+/* Fills in KEY for PAGE and returns true if PAGE is a read-only page of a
+ * file that is not in memory and would be read from the file, i.e. one
+ * that can come from the text cache.  That is either a page that has not
+ * been loaded yet or one that was dropped clean by eviction. */
+static bool
+vm_text_key (struct page *page, struct text_key *key) {
+	struct vma *vma = page->vma;
+
+	if (vma == NULL || vma->file == NULL || page->writable)
+		return false;
+	if (page->operations->type == VM_UNINIT
+			? page->uninit.init == NULL
+			: page->operations->type != VM_ANON
+				|| page->anon.where != ANON_FILE)
+		return false;
+	key->inode = file_get_inode (vma->file);
+	key->ofs = vma->offset + ((uint8_t *) page->va - (uint8_t *) vma->start);
+	key->read_bytes = vma_page_read_bytes (vma, page->va);
+	return true;
+}
+
+/* Returns true if PAGE is a page of a file mapping that holds file data,
+ * and so lives in the page cache, and then stores where in INODE and
+ * INDEX if they are not null.  The tail of a mapping past the end of the
+ * file is private zeroed memory. */
+static bool
+vm_cache_index (struct page *page, struct inode **inode, off_t *index) {
+	struct vma *vma = page->vma;
+
+	if (vma == NULL || vma->file == NULL
+			|| VM_TYPE (page_get_type (page)) != VM_FILE
+			|| vma_page_read_bytes (vma, page->va) == 0)
+		return false;
+	if (inode != NULL)
+		*inode = file_get_inode (vma->file);
+	if (index != NULL)
+		*index = (vma->offset
+				+ ((uint8_t *) page->va - (uint8_t *) vma->start)) / PGSIZE;
+	return true;
+}
+
+/* Returns the cached frame for KEY, or NULL.  Needs frame_lock. */
+static struct frame *
+text_cache_lookup (const struct text_key *key) {
+	struct text_entry probe;
+	struct hash_elem *e;
+
+	probe.key = *key;
+	e = hash_find (&text_cache, &probe.elem);
+	return e != NULL ? hash_entry (e, struct text_entry, elem)->frame : NULL;
+}
+
+/* Publishes FRAME, just loaded from KEY, in the text cache.  If another
+ * process loaded the same page meanwhile, FRAME simply stays private. */
+static void
+text_cache_insert (struct frame *frame, const struct text_key *key) {
+	struct text_entry *t = malloc (sizeof *t);
+	if (t == NULL)
+		return;
+	t->key = *key;
+	t->key.inode = inode_reopen (key->inode);
+	t->frame = frame;
+
+	lock_acquire (&frame_lock);
+	if (hash_insert (&text_cache, &t->elem) == NULL)
+		frame->text = t;
+	else {
+		inode_close (t->key.inode);
+		free (t);
+	}
+	lock_release (&frame_lock);
+}
+
+/* Maps PAGE, which is not in memory, to FRAME that already holds its
+ * contents, writable only if RW.  Needs frame_lock. */
+static bool
+vm_map_shared (struct page *page, struct frame *frame, bool rw) {
+	struct uninit_page *uninit = &page->uninit;
+
+	if (!vm_pte_set (page, frame->kva, rw))
+		return false;
+	if (page->operations->type == VM_ANON)
+		page->anon.where = ANON_MEMORY;     /* Dropped clean, see anon.c. */
+	else if (!uninit->page_initializer (page, uninit->type, frame->kva)) {
+		vm_pte_clear (page);
+		return false;
+	}
+	vm_page_link (page, frame);
+	return true;
+}
+
+/* Returns the batch that page table updates for PAGE go into: the open
+ * batch of its owner, when that is the current thread. */
+static struct pml4_batch *
+vm_pte_batch (struct page *page) {
+	if (page->owner != thread_current ())
+		return NULL;
+	return page->owner->spt.batch;
+}
+
+/* Maps PAGE to KVA in its owner's page table. */
+static bool
+vm_pte_set (struct page *page, void *kva, bool rw) {
+	struct pml4_batch *b = vm_pte_batch (page);
+
+	if (b != NULL)
+		return pml4_batch_set_page (b, page->va, kva, rw);
+	return pml4_set_page (page->owner->pml4, page->va, kva, rw);
+}
+
+/* Unmaps PAGE from its owner's page table, if it still has one. */
+static void
+vm_pte_clear (struct page *page) {
+	struct pml4_batch *b = vm_pte_batch (page);
+
+	if (page->owner->pml4 == NULL)
+		return;
+	if (b != NULL)
+		pml4_batch_clear_page (b, page->va);
+	else
+		pml4_clear_page (page->owner->pml4, page->va);
+}
+
+/* Links PAGE to FRAME and counts it in the resident set of its owner.
+ * Needs frame_lock. */
+static void
+vm_page_link (struct page *page, struct frame *frame) {
+	struct supplemental_page_table *spt = &page->owner->spt;
+
+	page->frame = frame;
+	list_push_back (&frame->pages, &page->frame_elem);
+	if (++spt->rss > spt->rss_peak)
+		spt->rss_peak = spt->rss;
+}
+
+/* Undoes vm_page_link().  Needs frame_lock. */
+static void
+vm_page_unlink (struct page *page) {
+	list_remove (&page->frame_elem);
+	page->frame = NULL;
+	page->owner->spt.rss--;
+}
+
+/* Drops FRAME from the text cache and the merge tables, as its contents
+ * are about to change or go away.  Needs frame_lock. */
+static void
+vm_frame_uncache (struct frame *frame) {
+	ksm_forget (frame);
+	if (frame->text != NULL) {
+		hash_delete (&text_cache, &frame->text->elem);
+		inode_close (frame->text->key.inode);
+		free (frame->text);
+		frame->text = NULL;
+	}
+}
+
+/* Takes FRAME, which no page maps any more, off the frame table and out
+ * of every cache.  Needs frame_lock. */
+static void
+vm_frame_forget (struct frame *frame) {
+	ASSERT (list_empty (&frame->pages));
+
+	vm_frame_uncache (frame);
+	if (clock_hand == &frame->elem)
+		clock_hand = list_next (clock_hand);
+	list_remove (&frame->elem);
+	frame_cnt--;
+}
+
+/* Gives back FRAME, taken with vm_get_frame() but never mapped. */
+void
+vm_free_unused_frame (struct frame *frame) {
+	lock_acquire (&frame_lock);
+	vm_frame_forget (frame);
+	lock_release (&frame_lock);
+	vm_free_frame (frame);
+}
+
+/* Unmaps PAGE from its frame.  The frame goes back to the user pool once
+ * no page maps it any more, unless the page cache keeps it.  Page types
+ * call this from their destroy handler, while the frame contents are no
+ * longer needed. */
+void
+vm_release_frame (struct page *page) {
+	struct frame *frame;
+
+	/* Look at the frame only under the lock, once eviction is done with
+	 * it. */
+	lock_acquire (&frame_lock);
+	vm_page_wait (page);
+	frame = page->frame;
+	if (frame == NULL) {
+		lock_release (&frame_lock);
+		return;
+	}
+	if (frame->huge != NULL)
+		vm_huge_split (frame->huge);
+	vm_pte_clear (page);
+	vm_page_unlink (page);
+	if (!list_empty (&frame->pages) || frame->pc != NULL)
+		frame = NULL;
+	else
+		vm_frame_forget (frame);
+	lock_release (&frame_lock);
+
+	if (frame != NULL)
+		vm_free_frame (frame);
+}
+
+/* Folds the dirty bit of the page table entry of PAGE into PAGE->dirty,
+ * before the entry is replaced or the page leaves memory. */
+void
+vm_page_sync_dirty (struct page *page) {
+	if (page->owner->pml4 != NULL
+			&& pml4_is_dirty (page->owner->pml4, page->va))
+		page->dirty = true;
+}
+
+/* Waits until some eviction in progress finishes.  Needs frame_lock. */
+void
+vm_evict_wait (void) {
+	cond_wait (&evict_done, &frame_lock);
+}
+
+/* Waits until PAGE is not on a frame that is being evicted.  PAGE is then
+ * either in memory for good or out of it.  Needs frame_lock. */
+void
+vm_page_wait (struct page *page) {
+	while (page->frame != NULL && page->frame->evicting)
+		vm_evict_wait ();
+}
+
+/* Moves PAGE onto FRAME.  The caller has already pointed the page table
+ * entry of PAGE at FRAME.  The old frame is freed if PAGE was its last
+ * user.  Needs frame_lock. */
+void
+vm_frame_move (struct page *page, struct frame *frame) {
+	struct frame *old = page->frame;
+
+	list_remove (&page->frame_elem);
+	page->frame = frame;
+	list_push_back (&frame->pages, &page->frame_elem);
+	if (list_empty (&old->pages) && old->pc == NULL) {
+		vm_frame_forget (old);
+		vm_free_frame (old);
+	}
+}
+
+/* Splits the huge page H into HUGE_PGCNT small pages mapping the same
+ * frames.  The page table was reserved when H was mapped, so this cannot
+ * fail.  Needs frame_lock. */
+static void
+vm_huge_split (struct huge_frame *h) {
+	struct supplemental_page_table *spt = &h->owner->spt;
+	struct list_elem *e = &h->first->elem;
+
+	if (h->owner->pml4 != NULL)
+		pml4_split_huge_page (h->owner->pml4, h->va, h->pt);
+	else
+		palloc_free_page (h->pt);
+	for (size_t i = 0; i < HUGE_PGCNT; i++, e = list_next (e))
+		list_entry (e, struct frame, elem)->huge = NULL;
+	spt->huge_cnt--;
+	spt->huge_splits++;
+	huge_splits++;
+	free (h);
+}
+
 /* Get the struct frame, that will be evicted. */
 static struct frame *
 vm_get_victim (void) {
-	struct frame *victim = NULL;
-	 /* TODO: The policy for eviction is up to you. */
+	/* Clock: sweep the frame table from the hand and give every frame
+	 * that was accessed since the last sweep a second chance.  Two turns
+	 * are enough unless every frame is pinned.  Needs frame_lock. */
+	for (size_t i = 0; i < 2 * frame_cnt; i++) {
+		if (clock_hand == NULL || clock_hand == list_end (&frame_table))
+			clock_hand = list_begin (&frame_table);
+
+		struct frame *frame = list_entry (clock_hand, struct frame, elem);
+		clock_hand = list_next (clock_hand);
+		if (frame->pinned)
+			continue;
+
+		/* A huge page ages as a whole, on the accessed bit of its one
+		 * entry.  It is split only once it is picked. */
+		struct huge_frame *h = frame->huge;
+		if (h != NULL) {
+			if (h->referenced || pml4_is_accessed (h->owner->pml4, h->va)) {
+				h->referenced = false;
+				pml4_set_accessed (h->owner->pml4, h->va, false);
+				while (clock_hand != list_end (&frame_table)
+						&& list_entry (clock_hand, struct frame, elem)->huge == h) {
+					clock_hand = list_next (clock_hand);
+					i++;
+				}
+				continue;
+			}
+			vm_huge_split (h);
+		}
+		if (!vm_frame_accessed (frame))
+			return frame;
+	}
+	return NULL;
+}
+
+/* Returns true if a page of FRAME was accessed since the last call, and
+ * clears the accessed bits.  Pages of a MADV_SEQUENTIAL region are used
+ * once, so their accesses do not keep them in memory.  Needs frame_lock. */
+static bool
+vm_frame_accessed (struct frame *frame) {
+	bool accessed = false;
+
+	for (struct list_elem *e = list_begin (&frame->pages);
+			e != list_end (&frame->pages); e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		if (page->owner->pml4 == NULL)
+			continue;
+		if (page->referenced
+				|| pml4_is_accessed (page->owner->pml4, page->va)) {
+			page->referenced = false;
+			pml4_set_accessed (page->owner->pml4, page->va, false);
+			if (page->vma == NULL || page->vma->advice != MADV_SEQUENTIAL)
+				accessed = true;
+		}
+	}
 
-	return victim;
+	/* read() and write() touch a cached page without any page table. */
+	if (frame->pc != NULL && frame->pc->referenced) {
+		frame->pc->referenced = false;
+		accessed = true;
+	}
+	return accessed;
 }
 
 /* 한 페이지를 제거하고 해당 프레임을 반환합니다.
- * 오류 발생 시 NULL을 반환합니다.*/
+ * 오류 발생 시 NULL을 반환합니다.
+ * The frame comes back pinned and empty, still on the frame table.
+ * Needs frame_lock. */
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
-	/* TODO: 피해자를 교체하고 퇴출된 프레임을 반환합니다. */
+	return vm_evict (vm_get_victim ());
+}
 
-	return NULL;
+/* Evicts every page of VICTIM, if not NULL, and returns it like
+ * vm_evict_frame().  Needs frame_lock, which is dropped while the pages
+ * are written out so that faults elsewhere do not wait for the swap
+ * disk.  Meanwhile VICTIM is pinned and marked as being evicted, and
+ * whoever needs one of its pages waits in vm_page_wait() until the
+ * eviction is over. */
+static struct frame *
+vm_evict (struct frame *victim) {
+	struct page *failed = NULL;
+	struct list_elem *e;
+
+	if (victim == NULL)
+		return NULL;
+	victim->pinned = true;
+	victim->evicting = true;
+	vm_frame_uncache (victim);
+
+	/* Unmap before copying out, so no owner can write behind our back
+	 * while swap_out sleeps on the disk. */
+	for (e = list_begin (&victim->pages); e != list_end (&victim->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		if (page->owner->pml4 != NULL)
+			pml4_clear_page (page->owner->pml4, page->va);
+		vm_page_sync_dirty (page);
+	}
+
+	lock_release (&frame_lock);
+	for (e = list_begin (&victim->pages); e != list_end (&victim->pages);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, frame_elem);
+		if (!swap_out (page)) {
+			failed = page;
+			break;
+		}
+	}
+	lock_acquire (&frame_lock);
+
+	while (!list_empty (&victim->pages)) {
+		struct page *page = list_entry (list_front (&victim->pages),
+				struct page, frame_elem);
+		if (page == failed)
+			break;
+		vm_page_unlink (page);
+	}
+	if (failed != NULL) {
+		/* Out of swap: map the rest of the pages back. */
+		bool rw_ok = victim->pc != NULL || list_size (&victim->pages) == 1;
+
+		for (e = list_begin (&victim->pages); e != list_end (&victim->pages);
+				e = list_next (e)) {
+			struct page *page = list_entry (e, struct page, frame_elem);
+			if (page->owner->pml4 != NULL)
+				pml4_set_page (page->owner->pml4, page->va, victim->kva,
+						page->writable && rw_ok);
+		}
+		victim->pinned = false;
+	} else if (victim->pc != NULL)
+		page_cache_evict (victim);
+
+	victim->evicting = false;
+	cond_broadcast (&evict_done, &frame_lock);
+	return failed == NULL ? victim : NULL;
+}
+
+/* Sets up FRAME for the user page at KVA, pinned and mapped by nothing. */
+static void
+vm_frame_init (struct frame *frame, void *kva) {
+	frame->kva = kva;
+	list_init (&frame->pages);
+	frame->pinned = true;
+	frame->evicting = false;
+	frame->text = NULL;
+	frame->ksm.state = KSM_NONE;
+	frame->ksm.checksum = 0;
+	frame->huge = NULL;
+	frame->pc = NULL;
+}
+
+/* Takes a free frame from the user pool without evicting anything.
+ * The frame comes back pinned; unpin it once its contents are in place.
+ * Returns NULL if the user pool is exhausted. */
+static struct frame *
+vm_try_get_frame (void) {
+	struct frame *frame = malloc (sizeof *frame);
+	if (frame == NULL)
+		return NULL;
+
+	vm_frame_init (frame, palloc_get_page (PAL_USER));
+	if (frame->kva == NULL) {
+		free (frame);
+		return NULL;
+	}
+
+	lock_acquire (&frame_lock);
+	list_push_back (&frame_table, &frame->elem);
+	frame_cnt++;
+	lock_release (&frame_lock);
+
+	if (palloc_user_free_pages () < kswapd_low && !kswapd_awake) {
+		kswapd_awake = true;
+		sema_up (&kswapd_sema);
+	}
+	return frame;
 }
 
 /* palloc() 함수를 사용하여 프레임을 가져옵니다. 
@@ -163,37 +822,523 @@ vm_evict_frame (void) {
  * 사용 가능한 메모리 공간을 확보합니다.*/
 static struct frame *
 vm_get_frame (void) {
-	struct frame *frame = malloc(sizeof(struct frame));
-	if (frame == NULL) {
-        PANIC("todo");
-    }
-	// palloc으로 프레임 할당
-	frame->kva = palloc_get_page(PAL_USER);
-	
-	// 메모리가 가득 찼거나 공간 부족 등으로 실패
-	if (frame->kva == NULL) {
-		free(frame);
-		PANIC("todo"); // swap 처리 필요
-		// 1. evict 대상 프레임 선택
-		// 2. 해당 프레임을 참조하는 페이지 테이블 항목 제거
-		// 3. 필요하면 swap 또는 파일로 기록
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct frame *frame = NULL;
+
+	/* 상한을 넘은 프로세스는 자기 페이지부터 내보낸다. */
+	lock_acquire (&frame_lock);
+	size_t cap = vm_rss_cap (spt);
+	if (cap != 0 && spt->rss >= cap) {
+		frame = vm_evict (vm_own_victim (spt));
+		if (frame != NULL)
+			spt->self_evicted++;
 	}
+	lock_release (&frame_lock);
+
+	if (frame == NULL)
+		frame = vm_try_get_frame ();
 
-	frame->page = NULL;
+	// 메모리가 가득 찼거나 공간 부족 등으로 실패
+	if (frame == NULL) {
+		lock_acquire (&frame_lock);
+		frame = vm_evict_frame ();
+		if (frame != NULL)
+			direct_reclaimed++;
+		lock_release (&frame_lock);
+	}
 
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+	/* NULL only if every frame is pinned or swap is full. */
+	ASSERT (frame == NULL || list_empty (&frame->pages));
 	return frame;
 }
 
+/* Takes a frame for the page cache, evicting another page for it only if
+ * MAY_EVICT.  The frame comes back pinned.  Returns NULL on failure. */
+struct frame *
+vm_alloc_frame (bool may_evict) {
+	return may_evict ? vm_get_frame () : vm_try_get_frame ();
+}
+
+/* Brings the working set estimate of SPT up to the passes done so far.
+ * Each pass weighs as much as all earlier ones together.  Needs
+ * frame_lock. */
+static void
+wss_fold (struct supplemental_page_table *spt) {
+	while (spt->wss_gen != wss_gen) {
+		spt->wss = (spt->wss + spt->wss_cur) / 2;
+		spt->wss_cur = 0;
+		spt->wss_gen++;
+		if (spt->wss == 0)
+			spt->wss_gen = wss_gen;
+	}
+}
+
+/* Counts PAGES accessed pages for SPT in the current pass.  Needs
+ * frame_lock. */
+static void
+wss_count (struct supplemental_page_table *spt, size_t pages) {
+	wss_fold (spt);
+	spt->wss_cur += pages;
+}
+
+/* Working set sampler.  Every wss_sample_ms it takes the accessed bit of
+ * every mapped page, counts it for the owner, and leaves it in
+ * page->referenced for the clock. */
+static void
+wssd (void *aux UNUSED) {
+	for (;;) {
+		timer_sleep ((int64_t) wss_sample_ms * TIMER_FREQ / 1000 + 1);
+
+		lock_acquire (&frame_lock);
+		for (struct list_elem *e = list_begin (&frame_table);
+				e != list_end (&frame_table); e = list_next (e)) {
+			struct frame *frame = list_entry (e, struct frame, elem);
+			struct huge_frame *h = frame->huge;
+
+			if (frame->pinned)
+				continue;
+			if (h != NULL) {
+				/* One accessed bit for the whole huge page. */
+				if (frame == h->first && h->owner->pml4 != NULL
+						&& pml4_is_accessed (h->owner->pml4, h->va)) {
+					pml4_set_accessed (h->owner->pml4, h->va, false);
+					h->referenced = true;
+					wss_count (&h->owner->spt, HUGE_PGCNT);
+				}
+				continue;
+			}
+			for (struct list_elem *pe = list_begin (&frame->pages);
+					pe != list_end (&frame->pages); pe = list_next (pe)) {
+				struct page *page = list_entry (pe, struct page, frame_elem);
+
+				/* The owner is past process_cleanup(). */
+				if (page->owner->pml4 == NULL)
+					continue;
+				if (pml4_is_accessed (page->owner->pml4, page->va)) {
+					pml4_set_accessed (page->owner->pml4, page->va, false);
+					page->referenced = true;
+					wss_count (&page->owner->spt, 1);
+				}
+			}
+		}
+		wss_gen++;
+		lock_release (&frame_lock);
+	}
+}
+
+/* Returns the resident set cap of SPT in pages, or 0 if it has none
+ * right now.  Needs frame_lock. */
+static size_t
+vm_rss_cap (struct supplemental_page_table *spt) {
+	size_t cap;
+
+	if (rss_limit != 0)
+		return rss_limit;
+	if (wss_sample_ms == 0 || palloc_user_free_pages () >= kswapd_low)
+		return 0;
+	wss_fold (spt);
+	cap = spt->wss + spt->wss / 2;
+	return cap > RSS_MIN_PAGES ? cap : RSS_MIN_PAGES;
+}
+
+static bool
+own_victim (struct page *page, void *victim_) {
+	struct page **victim = victim_;
+	struct frame *frame = page->frame;
+
+	if (frame == NULL || frame->pinned || list_size (&frame->pages) != 1)
+		return true;
+	if (frame->huge != NULL)
+		vm_huge_split (frame->huge);
+	if (vm_frame_accessed (frame))
+		return true;
+	*victim = page;
+	return false;
+}
+
+/* Picks a frame that only the current process, whose SPT is SPT, maps.
+ * Pages are visited in address order from where the last search
+ * stopped, with a second chance for the ones accessed since.  Returns
+ * NULL if there is none.  Needs frame_lock. */
+static struct frame *
+vm_own_victim (struct supplemental_page_table *spt) {
+	struct page *victim = NULL;
+
+	for (int pass = 0; pass < 4 && victim == NULL; pass++) {
+		if (pass % 2 == 0)
+			spt_for_each (spt, spt->reclaim_cursor, (void *) KERN_BASE,
+					own_victim, &victim);
+		else
+			spt_for_each (spt, NULL, spt->reclaim_cursor, own_victim,
+					&victim);
+	}
+	if (victim == NULL)
+		return NULL;
+	spt->reclaim_cursor = (uint8_t *) victim->va + PGSIZE;
+	return victim->frame;
+}
+
+/* Background reclaim.  Evicts frames in batches until the user pool is
+ * back above the high watermark, so that most faults find a free frame
+ * and never wait for a swap write themselves. */
+static void
+kswapd (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&kswapd_sema);
+		kswapd_wakeups++;
+
+		while (palloc_user_free_pages () < kswapd_high) {
+			size_t freed = 0;
+
+			lock_acquire (&frame_lock);
+			while (freed < KSWAPD_BATCH) {
+				struct frame *frame = vm_evict_frame ();
+				if (frame == NULL)
+					break;
+				vm_frame_forget (frame);
+				vm_free_frame (frame);
+				freed++;
+			}
+			kswapd_reclaimed += freed;
+			lock_release (&frame_lock);
+
+			if (freed < KSWAPD_BATCH)
+				break;
+		}
+		kswapd_awake = false;
+	}
+}
+
+/* Picks the watermarks and starts kswapd. */
+static void
+kswapd_init (void) {
+	size_t pages = palloc_user_pages ();
+
+	if (kswapd_low == 0)
+		kswapd_low = pages / 128 > 4 ? pages / 128 : 4;
+	if (kswapd_high <= kswapd_low)
+		kswapd_high = 2 * kswapd_low;
+	sema_init (&kswapd_sema, 0);
+	thread_create ("kswapd", PRI_DEFAULT, kswapd, NULL);
+}
+
+/* Prints reclaim statistics. */
+void
+vm_print_stats (void) {
+	printf ("Reclaim: %llu kswapd wakeups, %llu frames by kswapd, "
+			"%llu by faults\n",
+			kswapd_wakeups, kswapd_reclaimed, direct_reclaimed);
+	printf ("Huge pages: %llu faults, %llu splits\n", huge_faults,
+			huge_splits);
+	printf ("Processes: %zu exited", mm_report_cnt);
+	if (mm_report_cnt > MM_REPORT_MAX)
+		printf (", first %d shown", MM_REPORT_MAX);
+	printf ("\n");
+	for (struct list_elem *e = list_begin (&mm_reports);
+			e != list_end (&mm_reports); e = list_next (e)) {
+		struct mm_report *r = list_entry (e, struct mm_report, elem);
+		printf ("  %s (tid %d): %zu peak RSS, %zu WSS, %zu self-evicted, "
+				"%zu huge at peak, %zu split\n",
+				r->name, r->tid, r->rss_peak, r->wss, r->self_evicted,
+				r->huge_peak, r->huge_splits);
+	}
+}
+
+/* Creates the page for ADDR the first time an address inside one of the
+ * VMAs of SPT is touched.  Returns NULL if ADDR is not in any VMA. */
+static struct page *
+vm_page_from_vma (struct supplemental_page_table *spt, void *addr) {
+	struct vma *vma = vma_find (&spt->vmas, addr);
+	void *upage = pg_round_down (addr);
+
+	if (vma == NULL
+			|| !vm_alloc_page_with_initializer (vma->type, upage,
+				vma->writable, vma->init, NULL))
+		return NULL;
+
+	struct page *page = spt_find_page (spt, upage);
+	page->vma = vma;
+	return page;
+}
+
+/* Maps the not-yet-present pages of VMA around the file-backed page at VA
+ * that was just faulted in, so a program streaming through its text or
+ * data does not take one fault per page.  The window is fault_around_pages
+ * pages aligned on that many pages, or twice that many pages from VA on in
+ * a MADV_SEQUENTIAL region, clipped to the part of VMA that is read from
+ * the file.  MADV_RANDOM turns it off.  A file mapped with mmap() is only
+ * read around under MADV_SEQUENTIAL: without a hint its pages stay
+ * demand-paged, one fault each.  Only frames that are free right now are
+ * used; speculative pages never cause eviction. */
+static void
+vm_fault_around (struct supplemental_page_table *spt, struct vma *vma,
+		void *va) {
+	size_t n = fault_around_pages;
+	uint8_t *lo, *hi;
+
+	if (n <= 1 || vma->file == NULL || vma->advice == MADV_RANDOM)
+		return;
+	if (VM_TYPE (vma->type) == VM_FILE && vma->advice != MADV_SEQUENTIAL)
+		return;
+
+	if (vma->advice == MADV_SEQUENTIAL) {
+		lo = va;
+		hi = lo + 2 * n * PGSIZE;
+	} else {
+		lo = (uint8_t *) va - (pg_no (va) % n) * PGSIZE;
+		hi = lo + n * PGSIZE;
+	}
+	uint8_t *file_end = pg_round_up ((uint8_t *) vma->start + vma->read_bytes);
+	if (lo < (uint8_t *) vma->start)
+		lo = vma->start;
+	if (hi > file_end)
+		hi = file_end;
+
+	/* 파일 오프셋 순서대로 이어서 읽도록 낮은 주소부터 채운다. */
+	for (uint8_t *upage = lo; upage < hi; upage += PGSIZE) {
+		if (upage == va || spt_find_page (spt, upage) != NULL)
+			continue;
+
+		struct page *page = vm_page_from_vma (spt, upage);
+		if (page == NULL)
+			break;
+		if (!vm_claim_page_in (page, false)) {
+			spt_remove_page (spt, page);
+			break;
+		}
+	}
+}
+
+static bool
+spt_page_found (struct page *page UNUSED, void *aux UNUSED) {
+	return false;
+}
+
+/* Backs the aligned HUGE_PGSIZE window around ADDR with a huge page, if
+ * the whole window is zero-filled anonymous memory of one writable VMA,
+ * none of it has been touched yet, and the user pool can spare the
+ * frames without waking kswapd.  Returns false, having changed nothing,
+ * if any of that does not hold or memory runs out, and the fault is then
+ * served with a small page as usual. */
+static bool
+vm_try_huge (struct supplemental_page_table *spt, void *addr) {
+	uint8_t *base = (uint8_t *) ((uint64_t) addr & ~(HUGE_PGSIZE - 1));
+	struct vma *vma = vma_find (&spt->vmas, addr);
+	struct huge_frame *h;
+	struct list frames;
+	uint8_t *kva;
+
+	if (!thp_enabled || vma == NULL || !vma->writable
+			|| vma->type != VM_ANON
+			|| base < (uint8_t *) pg_round_up ((uint8_t *) vma->start
+				+ vma->read_bytes)
+			|| base + HUGE_PGSIZE > (uint8_t *) vma->end
+			|| palloc_user_free_pages () < HUGE_PGCNT + kswapd_high
+			|| !spt_for_each (spt, base, base + HUGE_PGSIZE, spt_page_found,
+				NULL))
+		return false;
+
+	h = malloc (sizeof *h);
+	if (h == NULL)
+		return false;
+	kva = palloc_get_aligned (PAL_USER, HUGE_PGCNT, HUGE_PGCNT);
+	if (kva == NULL) {
+		free (h);
+		return false;
+	}
+
+	/* Fill every page in its own frame, out of everyone's sight. */
+	list_init (&frames);
+	for (size_t i = 0; i < HUGE_PGCNT; i++) {
+		struct page *page = vm_page_from_vma (spt, base + i * PGSIZE);
+		struct frame *frame = page != NULL ? malloc (sizeof *frame) : NULL;
+
+		if (frame == NULL) {
+			if (page != NULL)
+				spt_remove_page (spt, page);
+			goto fail;
+		}
+		vm_frame_init (frame, kva + i * PGSIZE);
+		frame->huge = h;
+		list_push_back (&frames, &frame->elem);
+		page->frame = frame;
+		list_push_back (&frame->pages, &page->frame_elem);
+		if (!swap_in (page, frame->kva))
+			goto fail;
+	}
+
+	lock_acquire (&frame_lock);
+	h->pt = pml4_set_huge_page (thread_current ()->pml4, base, kva, true);
+	if (h->pt == NULL) {
+		lock_release (&frame_lock);
+		goto fail;
+	}
+	h->va = base;
+	h->owner = thread_current ();
+	h->first = list_entry (list_front (&frames), struct frame, elem);
+	while (!list_empty (&frames)) {
+		struct frame *frame = list_entry (list_pop_front (&frames),
+				struct frame, elem);
+		frame->pinned = false;
+		list_push_back (&frame_table, &frame->elem);
+	}
+	frame_cnt += HUGE_PGCNT;
+	spt->rss += HUGE_PGCNT;
+	if (spt->rss > spt->rss_peak)
+		spt->rss_peak = spt->rss;
+	if (++spt->huge_cnt > spt->huge_peak)
+		spt->huge_peak = spt->huge_cnt;
+	huge_faults++;
+	lock_release (&frame_lock);
+	return true;
+
+fail:
+	while (!list_empty (&frames)) {
+		struct frame *frame = list_entry (list_pop_front (&frames),
+				struct frame, elem);
+		struct page *page = list_entry (list_front (&frame->pages),
+				struct page, frame_elem);
+		list_remove (&page->frame_elem);
+		page->frame = NULL;
+		spt_remove_page (spt, page);
+		free (frame);
+	}
+	palloc_free_multiple (kva, HUGE_PGCNT);
+	free (h);
+	return false;
+}
+
+/* Faults in every page of the current process in [START, END) that lies
+ * in a VMA and is not in memory.  Pages go in address order, which for a
+ * file mapping is file order, so the reads run sequentially.  Without
+ * MAY_EVICT only free frames are used.  Stops at the first page that
+ * cannot be brought in; the rest simply faults in later. */
+void
+vm_populate (void *start, void *end, bool may_evict) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+
+	for (uint8_t *upage = pg_round_down (start); upage < (uint8_t *) end;
+			upage += PGSIZE) {
+		struct page *page = spt_find_page (spt, upage);
+		bool fresh = page == NULL;
+
+		if (fresh && (page = vm_page_from_vma (spt, upage)) == NULL)
+			continue;
+		if (page->frame != NULL)
+			continue;
+		if (!vm_claim_page_in (page, may_evict)) {
+			if (fresh)
+				spt_remove_page (spt, page);
+			break;
+		}
+	}
+}
+
+/* A range and the hint to record in the VMAs that overlap it. */
+struct madvise_arg {
+	void *start, *end;
+	enum madv advice;
+};
+
+static bool
+set_advice (struct vma *vma, void *aux) {
+	struct madvise_arg *arg = aux;
+
+	if (vma->start < arg->end && arg->start < vma->end)
+		vma->advice = arg->advice;
+	return true;
+}
+
+/* Drops a page that its VMA can recreate.  Dirty file pages are written
+ * back first by their destroy handler. */
+static bool
+drop_page (struct page *page, void *spt) {
+	if (page->vma != NULL)
+		spt_remove_page (spt, page);
+	return true;
+}
+
+/* Applies ADVICE to the current process's pages in [ADDR, ADDR + LENGTH).
+ * Access pattern hints apply to every VMA that overlaps the range as a
+ * whole; VMAs are not split.  MADV_DONTNEED drops the pages, and the next
+ * access reads them back from the file or gets a zeroed page.  Pages
+ * outside any VMA, such as the stack, are left alone.  Returns 0 on
+ * success, -1 on bad arguments. */
+int
+do_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	uint8_t *start = addr;
+	uint8_t *end = pg_round_up (start + length);
+
+	if (pg_ofs (start) != 0 || length == 0 || end <= start
+			|| !is_user_vaddr (end - 1))
+		return -1;
+
+	switch (advice) {
+		case MADV_NORMAL:
+		case MADV_SEQUENTIAL:
+		case MADV_RANDOM: {
+			struct madvise_arg arg = { start, end, advice };
+			vma_for_each (&spt->vmas, set_advice, &arg);
+			return 0;
+		}
+		case MADV_WILLNEED:
+			vm_populate (start, end, false);
+			return 0;
+		case MADV_DONTNEED:
+			spt_for_each (spt, start, end, drop_page, spt);
+			return 0;
+		default:
+			return -1;
+	}
+}
+
 /* Growing the stack. */
 static void
 vm_stack_growth (void *addr UNUSED) {
 }
 
-/* write_protected 페이지에서 오류를 처리합니다. */
+/* write_protected 페이지에서 오류를 처리합니다.
+ * PAGE is writable but maps a merged frame read-only: give it a private
+ * copy, or the frame itself if no other page maps it any more. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	struct frame *frame;
+
+	/* The frame may be evicted whenever frame_lock is not held.  Once it
+	 * is gone the page is simply not present any more, so bring it back
+	 * the usual way; the write faults again if it still needs a copy. */
+	lock_acquire (&frame_lock);
+	vm_page_wait (page);
+	frame = page->frame;
+	if (frame == NULL) {
+		lock_release (&frame_lock);
+		return vm_do_claim_page (page);
+	}
+	if (list_size (&frame->pages) == 1) {
+		ksm_forget (frame);
+		pml4_set_page (page->owner->pml4, page->va, frame->kva, true);
+		lock_release (&frame_lock);
+		return true;
+	}
+	lock_release (&frame_lock);
+
+	frame = vm_get_frame ();
+	if (frame == NULL)
+		return false;
+	lock_acquire (&frame_lock);
+	vm_page_wait (page);
+	if (page->frame == NULL) {
+		lock_release (&frame_lock);
+		vm_free_unused_frame (frame);
+		return vm_do_claim_page (page);
+	}
+	memcpy (frame->kva, page->frame->kva, PGSIZE);
+	pml4_set_page (page->owner->pml4, page->va, frame->kva, true);
+	vm_frame_move (page, frame);
+	frame->pinned = false;
+	lock_release (&frame_lock);
+	return true;
 }
 
 /* Return true on success */
@@ -203,17 +1348,32 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 	struct supplemental_page_table *spt = &thread_current ()->spt;
 	struct page *page = NULL;
 	
-	if(!(page = spt_find_page(spt, addr))) return false;
+	if ((page = spt_find_page (spt, addr)) == NULL) {
+		if (not_present && vm_try_huge (spt, addr)) {
+			thread_current ()->pf_kind = PF_HUGE;
+			return true;
+		}
+		if ((page = vm_page_from_vma (spt, addr)) == NULL)
+			return false;
+	}
 
 	/* write access */
 	if(write && !page->writable){
-		return vm_handle_wp(page);
+		return false;
+	}
+	if (write && !not_present) {
+		thread_current ()->pf_kind = PF_COW;
+		return vm_handle_wp (page);
 	}
 
 	/* present */
-	bool suc_claim = true;
 	if(not_present){
-		return vm_do_claim_page(page);
+		thread_current ()->pf_kind = vm_fault_kind (page);
+		if (!vm_do_claim_page (page))
+			return false;
+		if (page->vma != NULL)
+			vm_fault_around (spt, page->vma, page->va);
+		return true;
 	}
 
 	/* user에 대한 평가도 진행하긴 해야할 것 같다. 그런데 뭘 해야할지 모르겠음*/
@@ -221,6 +1381,18 @@ vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
 	return false;
 }
 
+/* Tells what kind of fault bringing PAGE in will be, for the fault
+ * statistics in userprog/exception.c. */
+static enum pf_kind
+vm_fault_kind (struct page *page) {
+	if (page->operations->type == VM_UNINIT)
+		return PF_LAZY;
+	if (page->operations->type == VM_ANON
+			&& (page->anon.where == ANON_ZSWAP || page->anon.where == ANON_ZERO))
+		return PF_MINOR;
+	return PF_MAJOR;
+}
+
 /* Free the page.
  * DO NOT MODIFY THIS FUNCTION. */
 void
@@ -246,111 +1418,267 @@ vm_claim_page (void *va UNUSED) {
 /* 페이지를 요청하고 mmu를 설정합니다. */
 static bool
 vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+	return vm_claim_page_in (page, true);
+}
 
-	/* Set links */
-	frame->page = page;  
-	page->frame = frame;
+/* Claims PAGE.  A page of a file mapping is mapped to its frame in the
+ * page cache.  A read-only text page that another process already loaded
+ * is mapped to the cached frame without any I/O.  Otherwise PAGE gets a
+ * new frame, evicting another page only if MAY_EVICT, and a text page is
+ * then published in the text cache. */
+static bool
+vm_claim_page_in (struct page *page, bool may_evict) {
+	struct text_key key;
+	bool text;
+	struct frame *frame;
 
-	struct thread *curr = thread_current();
-	if(!pml4_set_page (curr->pml4, page->va, frame->kva, page->writable)){
-		return false;
+	/* A page whose frame is being evicted is either out once that is
+	 * over, or back in place if it failed. */
+	lock_acquire (&frame_lock);
+	vm_page_wait (page);
+	frame = page->frame;
+	lock_release (&frame_lock);
+	if (frame != NULL)
+		return true;
+
+	text = vm_text_key (page, &key);
+	if (vm_cache_index (page, NULL, NULL))
+		return vm_claim_cached (page, may_evict);
+
+	if (text) {
+		bool ok = false;
+
+		lock_acquire (&frame_lock);
+		frame = text_cache_lookup (&key);
+		if (frame != NULL)
+			ok = vm_map_shared (page, frame, false);
+		lock_release (&frame_lock);
+		if (frame != NULL)
+			return ok;
 	}
-	if(pml4_get_page (curr->pml4, page->va) == NULL){
+
+	frame = may_evict ? vm_get_frame () : vm_try_get_frame ();
+	if (frame == NULL || !vm_claim_with_frame (page, frame))
+		return false;
+	if (text)
+		text_cache_insert (frame, &key);
+	frame->pinned = false;
+	return true;
+}
+
+/* Maps PAGE, a page of a file mapping, to the page cache frame that holds
+ * its part of the file, reading it in first if needed. */
+static bool
+vm_claim_cached (struct page *page, bool may_evict) {
+	struct inode *inode;
+	off_t index;
+	struct frame *frame;
+	bool ok;
+
+	vm_cache_index (page, &inode, &index);
+	frame = page_cache_get (inode, index, may_evict);
+	if (frame == NULL)
+		return false;
+	lock_acquire (&frame_lock);
+	ok = vm_map_shared (page, frame, page->writable);
+	page_cache_unpin (frame);
+	lock_release (&frame_lock);
+	return ok;
+}
+
+/* Maps PAGE to FRAME in its process and fills it in.  On failure FRAME
+ * is released. */
+static bool
+vm_claim_with_frame (struct page *page, struct frame *frame) {
+	/* Set links */
+	lock_acquire (&frame_lock);
+	vm_page_link (page, frame);
+	lock_release (&frame_lock);
+
+	if (!vm_pte_set (page, frame->kva, page->writable)
+			|| !swap_in (page, frame->kva)) {
+		vm_release_frame (page);
 		return false;
 	}
-	return swap_in (page, frame->kva);
+	return true;
 }
 
 /* Initialize new supplemental page table */
 void
-supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
-	/* 해쉬 테이블 초기화 */
-	hash_init(&spt->pages, spt_hash_func, spt_less_func, NULL);
-
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	spt->root = NULL;
+	vma_tree_init (&spt->vmas);
+	spt->batch = NULL;
+	spt->rss = spt->rss_peak = spt->self_evicted = 0;
+	spt->wss = spt->wss_cur = 0;
+	spt->wss_gen = wss_gen;
+	spt->reclaim_cursor = NULL;
+	spt->huge_cnt = spt->huge_peak = spt->huge_splits = 0;
 }
 
-/* Copy supplemental page table from src to dst */
-bool
-supplemental_page_table_copy (struct supplemental_page_table *dst,
-		struct supplemental_page_table *src) {
-	
-	struct hash_iterator i;
-	hash_first (&i, &src->pages);
-
-	while(hash_next(&i)){
-	    struct page *par_page = hash_entry (hash_cur (&i), struct page, he);
-		void *upage = par_page->va;
-		enum vm_type type = par_page->uninit.type;
-		bool writable = par_page->writable;
-		struct vm_intializer *init = par_page->uninit.init;
-		struct thread *curr = thread_current();
-		struct file_load_aux *par_aux = par_page->uninit.aux;
-		
-		/* page frame이 할당이 안된 경우 = 페이지가 초기상태일 때*/
-		if(par_page->frame == NULL){
-			struct file_load_aux *new_aux = malloc(sizeof(struct file_load_aux));
-			new_aux->file = par_aux->file;
-			new_aux->offset = par_aux->offset;
-			new_aux->read_bytes = par_aux->read_bytes;
-			new_aux->zero_bytes = par_aux->zero_bytes;
-			// struct file_load_aux *new_aux = par_aux;
-			if(vm_alloc_page_with_initializer(VM_ANON, upage, writable, init, new_aux))
-				continue;
-			else{
-				free(new_aux);
-				return false;
-			}
-		}
+/* Copies SRC_PAGE of the parent into the SPT DST of the current thread. */
+static bool
+spt_copy_page (struct page *src_page, void *dst_) {
+	struct supplemental_page_table *dst = dst_;
+	void *upage = src_page->va;
+	bool writable = src_page->writable;
 
-		if(!vm_alloc_page(type, upage, writable)){
-			return false;
-		}
-		if(!vm_claim_page(upage))
+	/* 아직 한 번도 접근되지 않은 페이지는 초기화 정보만 복사한다.
+	 * VMA에서 온 페이지는 자식의 VMA가 첫 fault 때 다시 만들어 준다. */
+	if (src_page->operations->type == VM_UNINIT) {
+		if (src_page->vma != NULL)
+			return true;
+		return vm_alloc_page_with_initializer (src_page->uninit.type, upage,
+				writable, src_page->uninit.init, NULL);
+	}
+
+	if (!vm_alloc_page (page_get_type (src_page), upage, writable))
+		return false;
+
+	struct page *dst_page = spt_find_page (dst, upage);
+	if (src_page->vma != NULL)
+		dst_page->vma = vma_find (&dst->vmas, upage);
+
+	/* 부모 프레임은 frame_lock을 쥐고, 진행 중인 eviction이 끝난 뒤에만
+	 * 본다. 그 사이에 쫓겨났으면 아래에서 다시 불러온다. */
+	lock_acquire (&frame_lock);
+	vm_page_wait (src_page);
+	vm_page_sync_dirty (src_page);
+	dst_page->dirty = src_page->dirty;
+
+	/* 공유 중인 text 프레임은 복사하지 않고 같이 매핑한다. */
+	if (src_page->frame != NULL && src_page->frame->text != NULL) {
+		bool ok = vm_map_shared (dst_page, src_page->frame, false);
+		lock_release (&frame_lock);
+		return ok;
+	}
+
+	/* 파일 매핑은 페이지 캐시 프레임을 같이 매핑한다. 캐시에 없으면
+	 * 자식의 첫 fault 때 캐시에서 가져온다. */
+	if (vm_cache_index (dst_page, NULL, NULL)) {
+		bool ok = true;
+
+		if (src_page->frame != NULL)
+			ok = vm_map_shared (dst_page, src_page->frame, writable);
+		lock_release (&frame_lock);
+		return ok;
+	}
+	lock_release (&frame_lock);
+
+	/* 복사가 끝날 때까지 프레임을 pin해 두어 병합 대상이 되지 않게 한다. */
+	struct frame *frame = vm_get_frame ();
+	if (frame == NULL)
 		return false;
-		
-		struct page *chd_page = spt_find_page(dst, upage);
-		if(chd_page == NULL){
+
+	/* 부모 페이지가 swap out 되어 있으면 다시 불러온다. frame_lock을
+	 * 쥐고 있는 동안에는 다시 쫓겨나지 않는다. */
+	lock_acquire (&frame_lock);
+	for (;;) {
+		vm_page_wait (src_page);
+		if (src_page->frame != NULL)
+			break;
+		lock_release (&frame_lock);
+		if (!vm_claim_page_in (src_page, true)) {
+			vm_free_unused_frame (frame);
 			return false;
 		}
-
-		memcpy(chd_page->frame->kva, par_page->frame->kva, PGSIZE);
+		lock_acquire (&frame_lock);
 	}
-	return true;
+	memcpy (frame->kva, src_page->frame->kva, PGSIZE);
+	lock_release (&frame_lock);
 
+	if (!vm_claim_with_frame (dst_page, frame))
+		return false;
+	frame->pinned = false;
+	return true;
 }
 
-static void destructor(struct hash_elem *he, void *aux) {
-	struct page *page = hash_entry(he, struct page, he);
-	struct frame *frame = page->frame;
-	vm_dealloc_page(page);
-}
-/* Free the resource hold by the supplemental page table */
+/* Sends the page table updates that the current process, whose SPT is
+ * SPT, makes to its own pages into batch B until spt_batch_end(). */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt) {
-	hash_clear(&spt->pages, destructor);
-}
+spt_batch_begin (struct supplemental_page_table *spt, struct pml4_batch *b) {
+	struct thread *t = thread_current ();
 
+	ASSERT (spt == &t->spt);
+	ASSERT (spt->batch == NULL);
 
-/* va에 대한 hash값을 구해서 반환한다. */
-static uint64_t
-spt_hash_func (const struct hash_elem *hash_e, void *aux) {
-	struct page *page = hash_entry(hash_e, struct page, he);
+	if (t->pml4 == NULL)
+		return;
+	pml4_batch_begin (b, t->pml4);
+	spt->batch = b;
+}
 
-	/* hash 값 계산 */
-	uint64_t hash = hash_bytes(&page->va, sizeof(page->va));
+/* Ends the batch that spt_batch_begin() opened, if any. */
+void
+spt_batch_end (struct supplemental_page_table *spt) {
+	if (spt->batch == NULL)
+		return;
+	pml4_batch_end (spt->batch);
+	spt->batch = NULL;
+}
+
+/* Copy supplemental page table from src to dst */
+bool
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	/* dst는 항상 현재 스레드(자식)의 spt이다. VMA를 먼저 복제해야
+	 * 페이지가 자기 VMA를 가리킬 수 있다. */
+	struct pml4_batch batch;
+	bool success;
 
-	return hash;
+	spt_batch_begin (dst, &batch);
+	success = vma_tree_copy (&dst->vmas, &src->vmas)
+		&& spt_for_each (src, NULL, (void *) KERN_BASE, spt_copy_page, dst);
+	spt_batch_end (dst);
+	return success;
 }
 
-/* 해쉬 두개의 크기를 비교한다. 보조 테이블 활용 가능*/
 static bool
-spt_less_func (const struct hash_elem *a,
-		const struct hash_elem *b,
-		void *aux) {
+spt_destroy_page (struct page *page, void *aux UNUSED) {
+	vm_dealloc_page (page);
+	return true;
+}
 
-	struct page *page_a = hash_entry(a, struct page, he);
-	struct page *page_b = hash_entry(b, struct page, he);
+/* Keeps the memory usage of the current process, which is done with
+ * SPT, for vm_print_stats(), and clears it.  Called once from
+ * process_exit(), so that exec does not report the same process twice. */
+void
+vm_mm_report (struct supplemental_page_table *spt) {
+	struct mm_report *r = NULL;
+
+	if (spt->rss_peak == 0)
+		return;
+	if (mm_report_cnt < MM_REPORT_MAX)
+		r = malloc (sizeof *r);
+	lock_acquire (&frame_lock);
+	wss_fold (spt);
+	if (r != NULL) {
+		strlcpy (r->name, thread_name (), sizeof r->name);
+		r->tid = thread_tid ();
+		r->rss_peak = spt->rss_peak;
+		r->wss = spt->wss;
+		r->self_evicted = spt->self_evicted;
+		r->huge_peak = spt->huge_peak;
+		r->huge_splits = spt->huge_splits;
+		list_push_back (&mm_reports, &r->elem);
+	}
+	mm_report_cnt++;
+	spt->rss_peak = spt->self_evicted = spt->wss = spt->wss_cur = 0;
+	spt->huge_peak = spt->huge_splits = 0;
+	lock_release (&frame_lock);
+}
 
-	return page_a->va > page_b->va;
-}
\ No newline at end of file
+/* Free the resource hold by the supplemental page table */
+void
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
+	if (spt->root != NULL) {
+		struct pml4_batch batch;
+
+		spt_batch_begin (spt, &batch);
+		spt_for_each (spt, NULL, (void *) KERN_BASE, spt_destroy_page, NULL);
+		spt_batch_end (spt);
+		spt_node_free (spt->root, 0);
+		spt->root = NULL;
+	}
+	vma_tree_kill (&spt->vmas);
+}
@@ -0,0 +1,282 @@
+/* vma.c: Virtual memory areas, kept in a per-process interval tree. */
+
+#include "vm/vm.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "threads/malloc.h"
+#include "threads/vaddr.h"
+
+static int
+height (const struct vma *n) {
+	return n != NULL ? n->height : 0;
+}
+
+static void *
+max_end (const struct vma *n) {
+	return n != NULL ? n->max_end : NULL;
+}
+
+/* Recomputes the augmented fields of N from its children. */
+static void
+update (struct vma *n) {
+	int hl = height (n->left), hr = height (n->right);
+	void *end = n->end;
+
+	n->height = (hl > hr ? hl : hr) + 1;
+	if (max_end (n->left) > end)
+		end = max_end (n->left);
+	if (max_end (n->right) > end)
+		end = max_end (n->right);
+	n->max_end = end;
+}
+
+static struct vma *
+rotate_right (struct vma *n) {
+	struct vma *l = n->left;
+	n->left = l->right;
+	l->right = n;
+	update (n);
+	update (l);
+	return l;
+}
+
+static struct vma *
+rotate_left (struct vma *n) {
+	struct vma *r = n->right;
+	n->right = r->left;
+	r->left = n;
+	update (n);
+	update (r);
+	return r;
+}
+
+/* Restores the AVL invariant at N and returns the new subtree root. */
+static struct vma *
+balance (struct vma *n) {
+	update (n);
+	int diff = height (n->left) - height (n->right);
+	if (diff > 1) {
+		if (height (n->left->left) < height (n->left->right))
+			n->left = rotate_left (n->left);
+		return rotate_right (n);
+	}
+	if (diff < -1) {
+		if (height (n->right->right) < height (n->right->left))
+			n->right = rotate_right (n->right);
+		return rotate_left (n);
+	}
+	return n;
+}
+
+static struct vma *
+insert (struct vma *n, struct vma *vma) {
+	if (n == NULL)
+		return vma;
+	if (vma->start < n->start)
+		n->left = insert (n->left, vma);
+	else
+		n->right = insert (n->right, vma);
+	return balance (n);
+}
+
+/* Unlinks the leftmost node of N into *MINP. */
+static struct vma *
+remove_min (struct vma *n, struct vma **minp) {
+	if (n->left == NULL) {
+		*minp = n;
+		return n->right;
+	}
+	n->left = remove_min (n->left, minp);
+	return balance (n);
+}
+
+static struct vma *
+remove (struct vma *n, struct vma *vma) {
+	ASSERT (n != NULL);
+	if (vma->start < n->start)
+		n->left = remove (n->left, vma);
+	else if (vma->start > n->start)
+		n->right = remove (n->right, vma);
+	else {
+		struct vma *l = n->left, *r = n->right, *min;
+		if (r == NULL)
+			return l;
+		r = remove_min (r, &min);
+		min->left = l;
+		min->right = r;
+		return balance (min);
+	}
+	return balance (n);
+}
+
+/* Initializes an empty TREE. */
+void
+vma_tree_init (struct vma_tree *tree) {
+	tree->root = NULL;
+}
+
+/* Creates a VMA for [START, END).  If FILE is non-null it is reopened, so
+ * the VMA owns its reference independently of the caller.
+ * Returns NULL if memory allocation fails. */
+struct vma *
+vma_create (void *start, void *end, struct file *file, off_t offset,
+		size_t read_bytes, bool writable, enum vm_type type,
+		vm_initializer *init) {
+	ASSERT (pg_ofs (start) == 0 && pg_ofs (end) == 0);
+	ASSERT (start < end);
+
+	struct vma *vma = malloc (sizeof *vma);
+	if (vma == NULL)
+		return NULL;
+	*vma = (struct vma) {
+		.start = start,
+		.end = end,
+		.file = NULL,
+		.offset = offset,
+		.read_bytes = read_bytes,
+		.writable = writable,
+		.type = type,
+		.init = init,
+		.advice = MADV_NORMAL,
+	};
+	if (file != NULL && (vma->file = file_reopen (file)) == NULL) {
+		free (vma);
+		return NULL;
+	}
+	return vma;
+}
+
+/* Inserts VMA into TREE.  Fails if it overlaps a VMA already there. */
+bool
+vma_insert (struct vma_tree *tree, struct vma *vma) {
+	if (vma_find_overlap (tree, vma->start, vma->end) != NULL)
+		return false;
+	vma->left = vma->right = NULL;
+	update (vma);
+	tree->root = insert (tree->root, vma);
+	return true;
+}
+
+/* Removes VMA from TREE.  VMA itself is not freed. */
+void
+vma_remove (struct vma_tree *tree, struct vma *vma) {
+	tree->root = remove (tree->root, vma);
+}
+
+/* Frees VMA and drops its file reference. */
+void
+vma_destroy (struct vma *vma) {
+	if (vma->file != NULL)
+		file_close (vma->file);
+	free (vma);
+}
+
+/* Returns a VMA of TREE that overlaps [START, END), or NULL. */
+struct vma *
+vma_find_overlap (struct vma_tree *tree, const void *start,
+		const void *end) {
+	struct vma *n = tree->root;
+
+	while (n != NULL) {
+		if (n->start < (void *) end && (void *) start < n->end)
+			return n;
+		/* If anything on the left reaches past START, the left subtree
+		 * is the only place an overlap can be, since the ranges there all
+		 * begin before N does. */
+		if (n->left != NULL && n->left->max_end > (void *) start)
+			n = n->left;
+		else
+			n = n->right;
+	}
+	return NULL;
+}
+
+/* Returns the VMA of TREE that contains VA, or NULL. */
+struct vma *
+vma_find (struct vma_tree *tree, const void *va) {
+	return vma_find_overlap (tree, va, (const uint8_t *) va + 1);
+}
+
+/* Returns how many bytes of the page at UPAGE inside VMA come from its
+ * file.  The rest of the page is zero-filled. */
+size_t
+vma_page_read_bytes (const struct vma *vma, const void *upage) {
+	size_t page_ofs = (const uint8_t *) upage - (const uint8_t *) vma->start;
+
+	if (page_ofs >= vma->read_bytes)
+		return 0;
+	return vma->read_bytes - page_ofs < PGSIZE
+		? vma->read_bytes - page_ofs : PGSIZE;
+}
+
+/* Returns the offset in the file of VMA of the page at UPAGE. */
+static off_t
+page_file_ofs (const struct vma *vma, const void *upage) {
+	return vma->offset + ((const uint8_t *) upage - (const uint8_t *) vma->start);
+}
+
+/* Reads the page at UPAGE inside VMA from its file into KVA and zeroes
+ * the rest of the page. */
+bool
+vma_read_page (const struct vma *vma, const void *upage, void *kva) {
+	size_t read_bytes = vma_page_read_bytes (vma, upage);
+
+	if (file_read_at (vma->file, kva, read_bytes,
+				page_file_ofs (vma, upage)) != (int) read_bytes)
+		return false;
+	memset ((uint8_t *) kva + read_bytes, 0, PGSIZE - read_bytes);
+	return true;
+}
+
+static bool
+for_each (struct vma *n, vma_for_each_func *func, void *aux) {
+	return n == NULL
+		|| (for_each (n->left, func, aux)
+				&& func (n, aux)
+				&& for_each (n->right, func, aux));
+}
+
+/* Calls FUNC on every VMA of TREE in increasing address order.  FUNC must
+ * not modify TREE.  Returns false if FUNC stopped the walk. */
+bool
+vma_for_each (struct vma_tree *tree, vma_for_each_func *func, void *aux) {
+	return for_each (tree->root, func, aux);
+}
+
+static bool
+copy_one (struct vma *src, void *dst_) {
+	struct vma_tree *dst = dst_;
+	struct vma *vma = vma_create (src->start, src->end, src->file,
+			src->offset, src->read_bytes, src->writable, src->type, src->init);
+	if (vma == NULL)
+		return false;
+	vma->advice = src->advice;
+	if (!vma_insert (dst, vma)) {
+		vma_destroy (vma);
+		return false;
+	}
+	return true;
+}
+
+/* Duplicates every VMA of SRC into the empty tree DST. */
+bool
+vma_tree_copy (struct vma_tree *dst, struct vma_tree *src) {
+	return vma_for_each (src, copy_one, dst);
+}
+
+static void
+kill_subtree (struct vma *n) {
+	if (n != NULL) {
+		kill_subtree (n->left);
+		kill_subtree (n->right);
+		vma_destroy (n);
+	}
+}
+
+/* Destroys every VMA of TREE and leaves it empty. */
+void
+vma_tree_kill (struct vma_tree *tree) {
+	kill_subtree (tree->root);
+	tree->root = NULL;
+}
@@ -0,0 +1,283 @@
+/* zswap.c: Compressed in-memory cache for swapped-out pages.
+ *
+ * Pages are compressed with a small LZ77 coder and stored in a pool of
+ * kernel pages.  Each pool page is cut into equal slots of one size
+ * class, so a compressed page takes the smallest class it fits in.
+ * Pages that do not compress to half a page or less are refused and go
+ * straight to the swap disk.  When the pool is at zswap_max_pages, the
+ * oldest entries are decompressed and handed to the writeback callback to
+ * make room.
+ *
+ * The pool has no lock of its own; callers serialize all calls. */
+
+#include "vm/zswap.h"
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* Pool pages at most.  0 disables the pool.  Set with "-zswap=PAGES". */
+size_t zswap_max_pages = 128;
+
+/* Size classes are multiples of CLASS_SIZE up to half a page; a larger
+ * class would not save any memory. */
+#define CLASS_SIZE 256
+#define CLASS_CNT (PGSIZE / 2 / CLASS_SIZE)
+#define MAX_SIZE (CLASS_SIZE * CLASS_CNT)
+
+/* A pool page cut into slots of one size class. */
+struct zpage {
+	void *kva;
+	unsigned cls;               /* Size class. */
+	unsigned used;              /* Number of slots in use. */
+	uint16_t map;               /* Bit i set if slot i is in use. */
+	struct list_elem elem;      /* In partial[CLS] while it has a free slot. */
+};
+
+/* One compressed page. */
+struct zswap_entry {
+	struct zpage *zpage;        /* Pool page holding the data. */
+	unsigned slot;              /* Slot within ZPAGE. */
+	size_t size;                /* Compressed size in bytes. */
+	void *owner;                /* Passed back to the writeback callback. */
+	struct list_elem lru_elem;  /* In lru. */
+};
+
+static struct list partial[CLASS_CNT];  /* Pool pages with free slots. */
+static struct list lru;         /* All entries, oldest first. */
+static size_t pool_pages;       /* Pool pages allocated. */
+static zswap_writeback_func *writeback;
+
+/* Work areas, kept static to stay off the kernel stack. */
+static uint8_t cbuf[MAX_SIZE];  /* Compressor output. */
+static uint8_t scratch[PGSIZE]; /* Decompressed page being written back. */
+static uint16_t dict[4096];     /* Last position + 1 of each 3-byte hash. */
+
+static size_t
+class_size (unsigned cls) {
+	return (cls + 1) * CLASS_SIZE;
+}
+
+static unsigned
+class_slots (unsigned cls) {
+	return PGSIZE / class_size (cls);
+}
+
+/* LZ77 coding.  The output is a sequence of tokens:
+ *   0nnnnnnn                 n + 1 literal bytes follow.
+ *   1lllllll oooooooo oooooooo
+ *                            copy l + 3 bytes from o bytes back. */
+#define MIN_MATCH 3
+#define MAX_MATCH (0x7f + MIN_MATCH)
+#define MAX_LITERALS 0x80
+
+static unsigned
+hash3 (const uint8_t *p) {
+	uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+	return (v * 2654435761u) >> 20;
+}
+
+/* Emits the literals [SRC, SRC + N) at *OP.  Returns false on overflow. */
+static bool
+emit_literals (const uint8_t *src, size_t n, uint8_t *dst, size_t *op,
+		size_t cap) {
+	while (n > 0) {
+		size_t run = n < MAX_LITERALS ? n : MAX_LITERALS;
+		if (*op + 1 + run > cap)
+			return false;
+		dst[(*op)++] = run - 1;
+		memcpy (dst + *op, src, run);
+		*op += run;
+		src += run;
+		n -= run;
+	}
+	return true;
+}
+
+/* Compresses the page at SRC into DST, which has room for CAP bytes.
+ * Returns the compressed size, or 0 if it does not fit. */
+static size_t
+lz_compress (const uint8_t *src, uint8_t *dst, size_t cap) {
+	size_t ip = 0, op = 0, lit = 0;
+
+	memset (dict, 0, sizeof dict);
+	while (ip + MIN_MATCH <= PGSIZE) {
+		unsigned h = hash3 (src + ip);
+		size_t cand = dict[h];
+
+		dict[h] = ip + 1;
+		if (cand == 0 || memcmp (src + cand - 1, src + ip, MIN_MATCH)) {
+			ip++;
+			continue;
+		}
+
+		cand--;
+		size_t len = MIN_MATCH;
+		while (ip + len < PGSIZE && len < MAX_MATCH
+				&& src[cand + len] == src[ip + len])
+			len++;
+
+		size_t off = ip - cand;
+		if (!emit_literals (src + lit, ip - lit, dst, &op, cap)
+				|| op + 3 > cap)
+			return 0;
+		dst[op++] = 0x80 | (len - MIN_MATCH);
+		dst[op++] = off & 0xff;
+		dst[op++] = off >> 8;
+		ip += len;
+		lit = ip;
+	}
+	if (!emit_literals (src + lit, PGSIZE - lit, dst, &op, cap))
+		return 0;
+	return op;
+}
+
+/* Decompresses SIZE bytes at SRC into the page at DST. */
+static void
+lz_decompress (const uint8_t *src, size_t size, uint8_t *dst) {
+	size_t ip = 0, op = 0;
+
+	while (ip < size) {
+		uint8_t tag = src[ip++];
+		if (tag < 0x80) {
+			size_t run = tag + 1;
+			memcpy (dst + op, src + ip, run);
+			ip += run;
+			op += run;
+		} else {
+			size_t len = (tag & 0x7f) + MIN_MATCH;
+			size_t off = src[ip] | (src[ip + 1] << 8);
+			ip += 2;
+			/* The source may overlap the output, so copy bytewise. */
+			for (; len > 0; len--, op++)
+				dst[op] = dst[op - off];
+		}
+	}
+	ASSERT (op == PGSIZE);
+}
+
+static void *
+entry_data (struct zswap_entry *e) {
+	return (uint8_t *) e->zpage->kva + e->slot * class_size (e->zpage->cls);
+}
+
+/* Sets up an empty pool.  WRITEBACK receives pages that age out. */
+void
+zswap_init (zswap_writeback_func *writeback_) {
+	for (unsigned cls = 0; cls < CLASS_CNT; cls++)
+		list_init (&partial[cls]);
+	list_init (&lru);
+	writeback = writeback_;
+}
+
+/* Writes the oldest entry back through the callback and frees it.
+ * Returns false if there is nothing to age out or the callback failed. */
+static bool
+age_oldest (void) {
+	if (list_empty (&lru))
+		return false;
+
+	struct zswap_entry *e = list_entry (list_front (&lru),
+			struct zswap_entry, lru_elem);
+	lz_decompress (entry_data (e), e->size, scratch);
+	if (!writeback (e->owner, scratch))
+		return false;
+	zswap_free (e);
+	return true;
+}
+
+/* Returns a pool page of class CLS with a free slot, making room by aging
+ * out old entries if the pool is full.  Returns NULL on failure. */
+static struct zpage *
+get_zpage (unsigned cls) {
+	struct zpage *zp;
+
+	while (list_empty (&partial[cls]) && pool_pages >= zswap_max_pages)
+		if (!age_oldest ())
+			return NULL;
+	if (!list_empty (&partial[cls]))
+		return list_entry (list_front (&partial[cls]), struct zpage, elem);
+
+	zp = malloc (sizeof *zp);
+	if (zp == NULL)
+		return NULL;
+	zp->kva = palloc_get_page (0);
+	if (zp->kva == NULL) {
+		free (zp);
+		return NULL;
+	}
+	zp->cls = cls;
+	zp->used = 0;
+	zp->map = 0;
+	list_push_back (&partial[cls], &zp->elem);
+	pool_pages++;
+	return zp;
+}
+
+/* Compresses the page at PAGE into the pool on behalf of OWNER.  Returns
+ * NULL if the page does not compress well or the pool has no room, in
+ * which case the caller should write it to disk itself. */
+struct zswap_entry *
+zswap_store (const void *page, void *owner) {
+	struct zswap_entry *e;
+	struct zpage *zp;
+	size_t size;
+	unsigned cls;
+
+	if (zswap_max_pages == 0)
+		return NULL;
+	size = lz_compress (page, cbuf, sizeof cbuf);
+	if (size == 0)
+		return NULL;
+	cls = (size - 1) / CLASS_SIZE;
+
+	e = malloc (sizeof *e);
+	if (e == NULL)
+		return NULL;
+	zp = get_zpage (cls);
+	if (zp == NULL) {
+		free (e);
+		return NULL;
+	}
+
+	for (e->slot = 0; zp->map & (1u << e->slot); e->slot++)
+		continue;
+	zp->map |= 1u << e->slot;
+	if (++zp->used == class_slots (cls))
+		list_remove (&zp->elem);
+
+	e->zpage = zp;
+	e->size = size;
+	e->owner = owner;
+	memcpy (entry_data (e), cbuf, size);
+	list_push_back (&lru, &e->lru_elem);
+	return e;
+}
+
+/* Decompresses ENTRY into PAGE.  ENTRY stays in the pool. */
+void
+zswap_load (struct zswap_entry *e, void *page) {
+	lz_decompress (entry_data (e), e->size, page);
+}
+
+/* Frees ENTRY and, when it was the last one in its pool page, the page. */
+void
+zswap_free (struct zswap_entry *e) {
+	struct zpage *zp = e->zpage;
+
+	list_remove (&e->lru_elem);
+	if (zp->used-- == class_slots (zp->cls))
+		list_push_back (&partial[zp->cls], &zp->elem);
+	zp->map &= ~(1u << e->slot);
+	free (e);
+
+	if (zp->used == 0) {
+		list_remove (&zp->elem);
+		palloc_free_page (zp->kva);
+		free (zp);
+		pool_pages--;
+	}
+}